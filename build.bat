@@ -6,4 +6,18 @@ set CLIBS=
 
 cl.exe %CFLAGS% /c /Fo:build\main.obj src\main.c %CLIBS% && ^
 cl.exe %CFLAGS% /c /Fo:build\utils.obj src\utils.c %CLIBS% && ^
-link.exe /out:build\todo-tui.exe build\main.obj build\utils.obj
+cl.exe %CFLAGS% /c /Fo:build\todo.obj src\todo.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\store.obj src\store.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\render.obj src\render.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\input.obj src\input.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\pool.obj src\pool.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\list.obj src\list.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\search.obj src\search.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\fuzzy.obj src\fuzzy.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\unicode.obj src\unicode.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\layout.obj src\layout.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\bench.obj src\bench.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\profile.obj src\profile.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\memory.obj src\memory.c %CLIBS% && ^
+cl.exe %CFLAGS% /c /Fo:build\scratch.obj src\scratch.c %CLIBS% && ^
+link.exe /out:build\todo-tui.exe build\main.obj build\utils.obj build\todo.obj build\store.obj build\render.obj build\input.obj build\pool.obj build\list.obj build\search.obj build\fuzzy.obj build\unicode.obj build\layout.obj build\bench.obj build\profile.obj build\memory.obj build\scratch.obj
@@ -2,7 +2,46 @@
 set -xe
 
 CFLAGS="-Wall -Wextra -pedantic -ggdb -std=c11"
-CLIBS=""
+CLIBS="-pthread"
+# ARENA=reserve builds with the reserve-and-commit arena backend of arena.h, ARENA=hugepages
+# also backs it with transparent huge pages, anything else keeps the malloc backend
+RESERVE_FLAGS="-DARENA_BACKEND=ARENA_BACKEND_LINUX_RESERVE"
+case "$ARENA" in
+    reserve) CFLAGS="$CFLAGS $RESERVE_FLAGS" ;;
+    hugepages) CFLAGS="$CFLAGS $RESERVE_FLAGS -DARENA_HUGE_PAGES" ;;
+esac
+SRC="src/main.c src/utils.c src/todo.c src/store.c src/render.c src/input.c src/pool.c src/list.c src/search.c src/fuzzy.c src/unicode.c src/layout.c src/bench.c src/profile.c src/memory.c src/scratch.c"
 
 mkdir -p build
-gcc $CFLAGS -o build/todo-tui src/main.c src/utils.c $CLIBS
+gcc $CFLAGS -o build/todo-tui $SRC $CLIBS
+
+# `./build.sh bench` also builds an optimized binary and runs every workload with it,
+# `scroll` over lists from 10 to 10M entries to show the frames do not grow with them
+if [ "$1" = "bench" ]; then
+    gcc $CFLAGS -O2 -DNDEBUG -o build/todo-tui-bench $SRC $CLIBS
+    for workload in add scroll:10 scroll:1000 scroll:100000 scroll:1000000 scroll:10000000 edit move search; do
+        ./build/todo-tui-bench --bench $workload
+    done
+fi
+
+# `./build.sh test` also checks the vector string scans of utils.c against plain loops
+if [ "$1" = "test" ]; then
+    gcc $CFLAGS -o build/test-simd test/simd.c src/utils.c $CLIBS
+    ./build/test-simd
+fi
+
+# `./build.sh profile` also builds a binary with the timers of profile.h compiled in
+if [ "$1" = "profile" ]; then
+    gcc $CFLAGS -DPROFILE -o build/todo-tui-profile $SRC $CLIBS
+fi
+
+# `./build.sh arena` also builds an optimized binary per arena backend and compares how
+# long they take to load the 1M entries of the scroll workload and how much they keep resident
+if [ "$1" = "arena" ]; then
+    gcc $CFLAGS -O2 -DNDEBUG -o build/todo-tui-malloc $SRC $CLIBS
+    gcc $CFLAGS -O2 -DNDEBUG $RESERVE_FLAGS -o build/todo-tui-reserve $SRC $CLIBS
+    gcc $CFLAGS -O2 -DNDEBUG $RESERVE_FLAGS -DARENA_HUGE_PAGES -o build/todo-tui-hugepages $SRC $CLIBS
+    for backend in malloc reserve hugepages; do
+        ./build/todo-tui-$backend --bench scroll --stats
+    done
+fi
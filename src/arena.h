@@ -39,22 +39,61 @@
 #define ARENA_BACKEND_LINUX_MMAP 1
 #define ARENA_BACKEND_WIN32_VIRTUALALLOC 2
 #define ARENA_BACKEND_WASM_HEAPBASE 3
+#define ARENA_BACKEND_LINUX_RESERVE 4
 
 #ifndef ARENA_BACKEND
 #define ARENA_BACKEND ARENA_BACKEND_LIBC_MALLOC
 #endif // ARENA_BACKEND
 
+// NOTE(nic): ARENA_BACKEND_LINUX_RESERVE reserves ARENA_RESERVE_BYTES of address space
+// for a region and only commits it ARENA_COMMIT_BYTES at a time as the region fills
+// up, so an arena is one contiguous region however big it gets instead of a chain of
+// small ones. With ARENA_HUGE_PAGES the reservation is also handed to transparent huge
+// pages, which then commits in whole huge pages.
+#ifndef ARENA_RESERVE_BYTES
+#define ARENA_RESERVE_BYTES ((size_t) 16 << 30)
+#endif // ARENA_RESERVE_BYTES
+
+#define ARENA_HUGE_PAGE_BYTES ((size_t) 2 << 20)
+
+#ifndef ARENA_COMMIT_BYTES
+#ifdef ARENA_HUGE_PAGES
+#define ARENA_COMMIT_BYTES ARENA_HUGE_PAGE_BYTES
+#else
+#define ARENA_COMMIT_BYTES ((size_t) 64 << 10)
+#endif // ARENA_HUGE_PAGES
+#endif // ARENA_COMMIT_BYTES
+
 typedef struct Region Region;
 
 struct Region {
     Region *next;
     size_t count;
     size_t capacity;
+#if ARENA_BACKEND == ARENA_BACKEND_LINUX_RESERVE
+    // Words of `data` that can be written to, the rest up to `capacity` is only reserved
+    size_t committed;
+#endif
     uintptr_t data[];
 };
 
+// NOTE(nic): Counting is off unless `Arena.stats` points somewhere. Arenas that point
+// at the same Arena_Stats are counted together, like an arena and the one replacing it.
+typedef struct {
+    size_t allocs;
+    size_t requested_bytes;
+    // Bytes left behind by arena_realloc() moving a block, the arena never reuses them
+    size_t realloc_wasted_bytes;
+    size_t regions_allocated;
+    // Allocations that did not fit into a region of ARENA_REGION_DEFAULT_CAPACITY
+    size_t oversized_allocs;
+    size_t region_bytes;
+    size_t peak_region_bytes;
+} Arena_Stats;
+
 typedef struct {
     Region *begin, *end;
+    Arena_Stats *stats;
 } Arena;
 
 typedef struct  {
@@ -68,6 +107,8 @@ typedef struct  {
 
 Region *new_region(size_t capacity);
 void free_region(Region *r);
+// Memory a region takes up, only the committed part of a reserved one
+size_t arena_region_bytes(Region *r);
 
 void *arena_alloc(Arena *a, size_t size_bytes);
 void *arena_realloc(Arena *a, void *oldptr, size_t oldsz, size_t newsz);
@@ -187,6 +228,46 @@ void free_region(Region *r)
     ARENA_ASSERT(ret == 0);
 }
 
+#elif ARENA_BACKEND == ARENA_BACKEND_LINUX_RESERVE
+#include <unistd.h>
+#include <sys/mman.h>
+
+Region *new_region(size_t capacity)
+{
+    size_t size_bytes = sizeof(Region) + sizeof(uintptr_t)*capacity;
+    if (size_bytes < ARENA_RESERVE_BYTES) size_bytes = ARENA_RESERVE_BYTES;
+    size_bytes = (size_bytes + ARENA_HUGE_PAGE_BYTES - 1)/ARENA_HUGE_PAGE_BYTES*ARENA_HUGE_PAGE_BYTES;
+
+    // Reserve one huge page more and cut the range down to a huge page boundary, so
+    // huge pages can back the region from its first byte
+    char *base = (char*)mmap(NULL, size_bytes + ARENA_HUGE_PAGE_BYTES, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    ARENA_ASSERT(base != MAP_FAILED);
+    size_t head = (ARENA_HUGE_PAGE_BYTES - (uintptr_t)base%ARENA_HUGE_PAGE_BYTES)%ARENA_HUGE_PAGE_BYTES;
+    if (head > 0) munmap(base, head);
+    munmap(base + head + size_bytes, ARENA_HUGE_PAGE_BYTES - head);
+
+    Region *r = (Region*)(base + head);
+#ifdef ARENA_HUGE_PAGES
+    madvise(r, size_bytes, MADV_HUGEPAGE);
+#endif
+    int ret = mprotect(r, ARENA_COMMIT_BYTES, PROT_READ | PROT_WRITE);
+    ARENA_ASSERT(ret == 0);
+    (void) ret;
+    r->next = NULL;
+    r->count = 0;
+    r->capacity = (size_bytes - sizeof(Region))/sizeof(uintptr_t);
+    r->committed = (ARENA_COMMIT_BYTES - sizeof(Region))/sizeof(uintptr_t);
+    return r;
+}
+
+void free_region(Region *r)
+{
+    size_t size_bytes = sizeof(Region) + sizeof(uintptr_t)*r->capacity;
+    int ret = munmap(r, size_bytes);
+    ARENA_ASSERT(ret == 0);
+    (void) ret;
+}
+
 #elif ARENA_BACKEND == ARENA_BACKEND_WIN32_VIRTUALALLOC
 
 #if !defined(_WIN32)
@@ -284,22 +365,68 @@ void free_region(Region *r)
 #  error "Unknown Arena backend"
 #endif
 
-// TODO: add debug statistic collection mode for arena
-// Should collect things like:
-// - How many times new_region was called
-// - How many times existing region was skipped
-// - How many times allocation exceeded ARENA_REGION_DEFAULT_CAPACITY
+size_t arena_region_bytes(Region *r)
+{
+#if ARENA_BACKEND == ARENA_BACKEND_LINUX_RESERVE
+    return sizeof(Region) + sizeof(uintptr_t)*r->committed;
+#else
+    return sizeof(Region) + sizeof(uintptr_t)*r->capacity;
+#endif
+}
+
+static void arena_stats_region_added(Arena *a, Region *r)
+{
+    if (a->stats == NULL) return;
+    a->stats->regions_allocated += 1;
+    a->stats->region_bytes += arena_region_bytes(r);
+    if (a->stats->region_bytes > a->stats->peak_region_bytes) {
+        a->stats->peak_region_bytes = a->stats->region_bytes;
+    }
+}
+
+static void arena_stats_region_freed(Arena *a, Region *r)
+{
+    if (a->stats == NULL) return;
+    a->stats->region_bytes -= arena_region_bytes(r);
+}
+
+#if ARENA_BACKEND == ARENA_BACKEND_LINUX_RESERVE
+// Commits the region up to at least `count` words of data
+static void arena_commit(Arena *a, Region *r, size_t count)
+{
+    size_t committed_bytes = arena_region_bytes(r);
+    size_t needed_bytes = sizeof(Region) + sizeof(uintptr_t)*count;
+    needed_bytes = (needed_bytes + ARENA_COMMIT_BYTES - 1)/ARENA_COMMIT_BYTES*ARENA_COMMIT_BYTES;
+    int ret = mprotect((char*)r + committed_bytes, needed_bytes - committed_bytes, PROT_READ | PROT_WRITE);
+    ARENA_ASSERT(ret == 0);
+    (void) ret;
+    r->committed = (needed_bytes - sizeof(Region))/sizeof(uintptr_t);
+    if (a->stats != NULL) {
+        a->stats->region_bytes += needed_bytes - committed_bytes;
+        if (a->stats->region_bytes > a->stats->peak_region_bytes) {
+            a->stats->peak_region_bytes = a->stats->region_bytes;
+        }
+    }
+}
+#endif // ARENA_BACKEND_LINUX_RESERVE
 
 void *arena_alloc(Arena *a, size_t size_bytes)
 {
     size_t size = (size_bytes + sizeof(uintptr_t) - 1)/sizeof(uintptr_t);
 
+    if (a->stats != NULL) {
+        a->stats->allocs += 1;
+        a->stats->requested_bytes += size_bytes;
+        if (size > ARENA_REGION_DEFAULT_CAPACITY) a->stats->oversized_allocs += 1;
+    }
+
     if (a->end == NULL) {
         ARENA_ASSERT(a->begin == NULL);
         size_t capacity = ARENA_REGION_DEFAULT_CAPACITY;
         if (capacity < size) capacity = size;
         a->end = new_region(capacity);
         a->begin = a->end;
+        arena_stats_region_added(a, a->end);
     }
 
     while (a->end->count + size > a->end->capacity && a->end->next != NULL) {
@@ -312,8 +439,13 @@ void *arena_alloc(Arena *a, size_t size_bytes)
         if (capacity < size) capacity = size;
         a->end->next = new_region(capacity);
         a->end = a->end->next;
+        arena_stats_region_added(a, a->end);
     }
 
+#if ARENA_BACKEND == ARENA_BACKEND_LINUX_RESERVE
+    if (a->end->count + size > a->end->committed) arena_commit(a, a->end, a->end->count + size);
+#endif
+
     void *result = &a->end->data[a->end->count];
     a->end->count += size;
     return result;
@@ -322,6 +454,7 @@ void *arena_alloc(Arena *a, size_t size_bytes)
 void *arena_realloc(Arena *a, void *oldptr, size_t oldsz, size_t newsz)
 {
     if (newsz <= oldsz) return oldptr;
+    if (a->stats != NULL) a->stats->realloc_wasted_bytes += oldsz;
     void *newptr = arena_alloc(a, newsz);
     char *newptr_char = (char*)newptr;
     char *oldptr_char = (char*)oldptr;
@@ -423,6 +556,7 @@ void arena_free(Arena *a)
     while (r) {
         Region *r0 = r;
         r = r->next;
+        arena_stats_region_freed(a, r0);
         free_region(r0);
     }
     a->begin = NULL;
@@ -434,6 +568,7 @@ void arena_trim(Arena *a){
     while (r) {
         Region *r0 = r;
         r = r->next;
+        arena_stats_region_freed(a, r0);
         free_region(r0);
     }
     a->end->next = NULL;
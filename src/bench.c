@@ -0,0 +1,183 @@
+#include <string.h>
+#include <errno.h>
+
+#include "./bench.h"
+#include "./todo.h"
+#include "./plat.h"
+
+#define KEY_UP "\033[A"
+#define KEY_DOWN "\033[B"
+#define KEY_RIGHT "\033[C"
+#define KEY_LEFT "\033[D"
+#define KEY_HOME "\033[H"
+#define KEY_END "\033[F"
+#define KEY_PAGE_DOWN "\033[6~"
+#define KEY_BACKSPACE "\x7f"
+#define KEY_ENTER "\r"
+
+#define script_append(arena, script, keys) arena_da_append_many((arena), (script), (keys), sizeof(keys) - 1)
+
+const char *bench_workload_names = "add|scroll|edit|move|search";
+
+void bench_begin(Bench *bench, Pool *pool) {
+    bench->count = 0;
+    bench->bytes = 0;
+    bench->max_bytes = 0;
+    bench->allocs = pool->allocs;
+    bench->reuses = pool->reuses;
+    bench->start_ns = get_time_ns();
+}
+
+void bench_record(Bench *bench, uint64_t ns, size_t bytes) {
+    arena_da_append(&bench->arena, bench, ns);
+    bench->bytes += bytes;
+    bench->max_bytes = MAX(bench->max_bytes, bytes);
+}
+
+static int compare_ns(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Nearest rank on the sorted latencies
+static double percentile_us(Bench *bench, double p) {
+    size_t rank = (size_t) (p*(bench->count - 1) + 0.5);
+    return bench->items[rank]/1000.0;
+}
+
+void bench_report(Bench *bench, Pool *pool, const char *name, FILE *stream) {
+    double total_ms = (get_time_ns() - bench->start_ns)/1000000.0;
+    fprintf(stream, "%s: %zu events in %.1fms\n", name, bench->count, total_ms);
+    fprintf(stream, "    load: %.1fms, peak RSS %.1fMiB\n", bench->load_ns/1000000.0, get_peak_rss()/(1024.0*1024.0));
+    if (bench->count == 0) {
+        return;
+    }
+    qsort(bench->items, bench->count, sizeof(*bench->items), compare_ns);
+    fprintf(stream, "    latency: p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus\n",
+            percentile_us(bench, 0.50), percentile_us(bench, 0.90),
+            percentile_us(bench, 0.99), percentile_us(bench, 1.0));
+    fprintf(stream, "    output: %zu bytes, %.1f per event, %zu in the biggest frame\n",
+            bench->bytes, (double) bench->bytes/bench->count, bench->max_bytes);
+    size_t allocs = pool->allocs - bench->allocs;
+    size_t reuses = pool->reuses - bench->reuses;
+    fprintf(stream, "    pool: %zu allocations, %.2f per event, %zu served from the free lists\n",
+            allocs, (double) allocs/bench->count, reuses);
+}
+
+static void fill_list(Pool *pool, TODO_App *app, TODO_List_Index list_index, size_t count) {
+    char text[64];
+    for (size_t i = 0; i < count; ++i) {
+        int size = snprintf(text, sizeof(text), "entry number %zu of the workload", i);
+        app_add_entry(pool, app, list_index, text, size, 0);
+    }
+}
+
+bool bench_workload(const char *name, Pool *pool, TODO_App *app, Arena *arena, String *script) {
+    size_t entries = 0;
+    const char *colon = strchr(name, ':');
+    size_t name_size = colon != NULL ? (size_t) (colon - name) : strlen(name);
+    if (colon != NULL) {
+        String_View digits = SV(colon + 1);
+        if (digits.size == 0 || digits.size > 9) {
+            return false;
+        }
+        for (size_t i = 0; i < digits.size; ++i) {
+            if (digits.data[i] < '0' || digits.data[i] > '9') {
+                return false;
+            }
+        }
+        entries = sv_to_uint64(digits);
+        if (entries == 0 || entries > BENCH_MAX_ENTRIES) {
+            return false;
+        }
+    }
+#define workload_is(workload) (name_size == strlen(workload) && memcmp(name, (workload), name_size) == 0)
+#define entries_or(default_entries) (entries > 0 ? entries : (default_entries))
+
+    if (workload_is("add")) {
+        if (entries > 0) {
+            return false;
+        }
+        // Typing new entries into an empty list, one frame per keystroke
+        for (size_t i = 0; i < BENCH_ADD_COUNT; ++i) {
+            str_append_fmt(arena, script, "abuy %zu more things for the trip" KEY_ENTER, i);
+        }
+    } else if (workload_is("scroll")) {
+        // Paging through a huge list, then walking back up the end of it
+        fill_list(pool, app, TODO_LIST_TODOS, entries_or(BENCH_SCROLL_ENTRIES));
+        for (size_t i = 0; i < BENCH_SCROLL_PAGES; ++i) {
+            script_append(arena, script, KEY_PAGE_DOWN);
+        }
+        script_append(arena, script, KEY_END);
+        for (size_t i = 0; i < BENCH_SCROLL_UPS; ++i) {
+            script_append(arena, script, KEY_UP);
+        }
+        script_append(arena, script, KEY_HOME);
+    } else if (workload_is("edit")) {
+        // Appending to entries, fixing typos in them and saving them
+        size_t edit_entries = entries_or(BENCH_EDIT_ENTRIES);
+        fill_list(pool, app, TODO_LIST_TODOS, edit_entries);
+        for (size_t i = 0; i < BENCH_EDIT_COUNT; ++i) {
+            if (i % edit_entries == 0) {
+                script_append(arena, script, KEY_HOME);
+            }
+            script_append(arena, script, "e" KEY_END " edietd");
+            script_append(arena, script, KEY_BACKSPACE KEY_BACKSPACE KEY_BACKSPACE "ted");
+            script_append(arena, script, KEY_LEFT KEY_LEFT KEY_LEFT KEY_LEFT KEY_LEFT KEY_LEFT "!");
+            script_append(arena, script, KEY_ENTER KEY_DOWN);
+        }
+    } else if (workload_is("move")) {
+        // Moving entries to the done list and all of them back
+        fill_list(pool, app, TODO_LIST_TODOS, entries_or(BENCH_MOVE_ENTRIES));
+        for (size_t i = 0; i < BENCH_MOVE_COUNT/2; ++i) {
+            script_append(arena, script, KEY_ENTER);
+        }
+        script_append(arena, script, KEY_RIGHT);
+        for (size_t i = 0; i < BENCH_MOVE_COUNT/2; ++i) {
+            script_append(arena, script, KEY_ENTER);
+        }
+        script_append(arena, script, KEY_LEFT);
+    } else if (workload_is("search")) {
+        // Typing queries into the search of a huge list and erasing them again,
+        // the first keys of each have no trigram yet
+        size_t search_entries = entries_or(BENCH_SEARCH_ENTRIES);
+        fill_list(pool, app, TODO_LIST_TODOS, search_entries);
+        for (size_t i = 0; i < BENCH_SEARCH_COUNT; ++i) {
+            char query[32];
+            int size = snprintf(query, sizeof(query), "number %zu ", i*7919 % search_entries);
+            script_append(arena, script, "/");
+            for (int j = 0; j < size; ++j) {
+                arena_da_append(arena, script, query[j]);
+            }
+            for (int j = 0; j < size; ++j) {
+                script_append(arena, script, KEY_BACKSPACE);
+            }
+            script_append(arena, script, KEY_ENTER);
+        }
+    } else {
+        return false;
+    }
+    return true;
+#undef workload_is
+#undef entries_or
+}
+
+bool read_script(const char *path, Arena *arena, String *script) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Error: could not open script `%s`: %s\n", path, strerror(errno));
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        arena_da_append_many(arena, script, buffer, n);
+    }
+    bool ok = !ferror(file);
+    if (!ok) {
+        fprintf(stderr, "Error: could not read script `%s`\n", path);
+    }
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,65 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "./arena.h"
+#include "./utils.h"
+#include "./pool.h"
+
+// Defined in todo.h
+typedef struct TODO_App TODO_App;
+
+// Entries the workloads that need a full list start with, unless the name says
+// otherwise like `scroll:10000000`
+#define BENCH_MAX_ENTRIES 100000000
+#define BENCH_SCROLL_ENTRIES 1000000
+#define BENCH_EDIT_ENTRIES 1000
+#define BENCH_MOVE_ENTRIES 10000
+#define BENCH_SEARCH_ENTRIES 1000000
+// How often each workload repeats its keys, about a second or two in a debug build
+// The keys of `scroll` do not depend on its entries, so any size costs the same frames
+#define BENCH_SCROLL_PAGES 50000
+#define BENCH_SCROLL_UPS 10000
+#define BENCH_ADD_COUNT 2000
+#define BENCH_EDIT_COUNT 2000
+#define BENCH_MOVE_COUNT 10000
+#define BENCH_SEARCH_COUNT 50
+
+// NOTE(nic): A headless run feeds a script of raw terminal bytes to the input layer,
+// as if it was typed, and draws a frame after every event instead of after every
+// burst. Each event is timed from its update to the flush of its frame, which is
+// the latency the user would see on a terminal that takes the bytes right away.
+typedef struct {
+    Arena arena;
+    uint64_t *items;
+    size_t count;
+    size_t capacity;
+
+    // What building the workload or loading the store took before the first frame
+    uint64_t load_ns;
+    uint64_t start_ns;
+    size_t bytes;
+    size_t max_bytes;
+    size_t allocs;
+    size_t reuses;
+} Bench;
+
+void bench_begin(Bench *bench, Pool *pool);
+void bench_record(Bench *bench, uint64_t ns, size_t bytes);
+// Prints the load time, the latency percentiles and what the frames, the pool and the process cost
+void bench_report(Bench *bench, Pool *pool, const char *name, FILE *stream);
+
+// Fills `app` with what the workload starts from and `script` with its keystrokes,
+// false if there is no workload called `name`. `name:entries` sets how many
+// entries the list starts with, for every workload but `add`.
+bool bench_workload(const char *name, Pool *pool, TODO_App *app, Arena *arena, String *script);
+// Names of the workloads separated by `|`, for the usage
+extern const char *bench_workload_names;
+
+bool read_script(const char *path, Arena *arena, String *script);
+
+#endif // BENCH_H_
@@ -0,0 +1,301 @@
+#include <assert.h>
+#include <string.h>
+
+#include "./fuzzy.h"
+#include "./todo.h"
+#include "./plat.h"
+
+static bool is_separator(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '/' || ch == '-' || ch == '_'
+        || ch == '.' || ch == ',' || ch == ':' || ch == ';';
+}
+
+// Matching at the start of a word is worth more, since that is where people aim
+static int char_bonus(String_View text, size_t i) {
+    if (i == 0) {
+        return FUZZY_BONUS_BOUNDARY;
+    }
+    unsigned char prev = text.data[i - 1];
+    unsigned char ch = text.data[i];
+    if (is_separator(prev)) {
+        return FUZZY_BONUS_BOUNDARY;
+    }
+    if ((islower(prev) && isupper(ch)) || (!isdigit(prev) && isdigit(ch))) {
+        return FUZZY_BONUS_CAMEL;
+    }
+    return 0;
+}
+
+bool fuzzy_score(String_View text, String_View pattern, int *score) {
+    if (pattern.size == 0) {
+        *score = 0;
+        return true;
+    }
+
+    // NOTE(nic): Same as fzf's v1 algorithm: the forward scan finds where the earliest
+    // match ends, the backward scan from there finds the latest start for that end,
+    // only the window in between is scored
+    size_t p = 0;
+    size_t end = 0;
+    for (size_t i = 0; i < text.size && p < pattern.size; ++i) {
+        if ((char) tolower((unsigned char) text.data[i]) == pattern.data[p]) {
+            p += 1;
+            end = i + 1;
+        }
+    }
+    if (p < pattern.size) {
+        return false;
+    }
+    size_t start = end;
+    while (p > 0) {
+        start -= 1;
+        if ((char) tolower((unsigned char) text.data[start]) == pattern.data[p - 1]) {
+            p -= 1;
+        }
+    }
+
+    int total = 0;
+    int run_bonus = 0;
+    bool consecutive = false;
+    bool in_gap = false;
+    for (size_t i = start; i < end; ++i) {
+        if (p < pattern.size && (char) tolower((unsigned char) text.data[i]) == pattern.data[p]) {
+            int bonus = char_bonus(text, i);
+            if (consecutive) {
+                // A run keeps the bonus of the character it started on
+                bonus = MAX(bonus, MAX(run_bonus, FUZZY_BONUS_CONSECUTIVE));
+            } else {
+                run_bonus = bonus;
+            }
+            if (p == 0) {
+                bonus *= FUZZY_BONUS_FIRST_MULT;
+            }
+            total += FUZZY_SCORE_MATCH + bonus;
+            p += 1;
+            consecutive = true;
+            in_gap = false;
+        } else {
+            total += in_gap ? FUZZY_GAP_EXTENSION : FUZZY_GAP_START;
+            consecutive = false;
+            in_gap = true;
+        }
+    }
+    *score = total;
+    return true;
+}
+
+// Higher score first, then the shorter text, then the earlier entry
+static bool match_better(Fuzzy_Match a, Fuzzy_Match b) {
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.size != b.size) {
+        return a.size < b.size;
+    }
+    return a.position < b.position;
+}
+
+static int match_compare(const void *a, const void *b) {
+    const Fuzzy_Match *x = a;
+    const Fuzzy_Match *y = b;
+    return match_better(*x, *y) ? -1 : match_better(*y, *x) ? 1 : 0;
+}
+
+static void heap_push(Fuzzy_Match *heap, size_t *count, Fuzzy_Match match) {
+    size_t i;
+    if (*count < FUZZY_TOP_K) {
+        i = (*count)++;
+        while (i > 0 && match_better(heap[(i - 1)/2], match)) {
+            heap[i] = heap[(i - 1)/2];
+            i = (i - 1)/2;
+        }
+        heap[i] = match;
+        return;
+    }
+    if (!match_better(match, heap[0])) {
+        return;
+    }
+    i = 0;
+    while (true) {
+        size_t child = 2*i + 1;
+        if (child >= *count) {
+            break;
+        }
+        if (child + 1 < *count && match_better(heap[child], heap[child + 1])) {
+            child += 1;
+        }
+        if (!match_better(match, heap[child])) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = match;
+}
+
+static int fuzzy_worker(void *arg) {
+    Fuzzy *fuzzy = arg;
+    Fuzzy_Match local[FUZZY_TOP_K];
+
+    mtx_lock(&fuzzy->mutex);
+    while (true) {
+        while (fuzzy->next >= fuzzy->id_count) {
+            cnd_wait(&fuzzy->work, &fuzzy->mutex);
+        }
+        size_t start = fuzzy->next;
+        size_t end = MIN(start + FUZZY_BATCH, fuzzy->id_count);
+        fuzzy->next = end;
+        fuzzy->busy += 1;
+        uint64_t generation = fuzzy->generation;
+        String_View pattern = sv_from_parts(fuzzy->pattern, fuzzy->pattern_size);
+        mtx_unlock(&fuzzy->mutex);
+
+        size_t local_count = 0;
+        size_t matched = 0;
+        for (size_t i = start; i < end; ++i) {
+            Entry *entry = app_entry(fuzzy->app, fuzzy->ids[i]);
+            int score;
+            if (fuzzy_score(entry_text(entry), pattern, &score)) {
+                Fuzzy_Match match = { score, entry->size, i, fuzzy->ids[i] };
+                heap_push(local, &local_count, match);
+                matched += 1;
+            }
+        }
+
+        mtx_lock(&fuzzy->mutex);
+        if (generation == fuzzy->generation) {
+            for (size_t i = 0; i < local_count; ++i) {
+                heap_push(fuzzy->top, &fuzzy->top_count, local[i]);
+            }
+            fuzzy->scored += end - start;
+            fuzzy->matched += matched;
+            fuzzy->changed = true;
+        }
+        fuzzy->busy -= 1;
+        if (fuzzy->busy == 0) {
+            cnd_broadcast(&fuzzy->idle);
+        }
+    }
+    return 0;
+}
+
+static void fuzzy_cancel(Fuzzy *fuzzy) {
+    if (fuzzy->worker_count == 0) {
+        return;
+    }
+    mtx_lock(&fuzzy->mutex);
+    fuzzy->generation += 1;
+    fuzzy->next = fuzzy->id_count;
+    fuzzy->changed = false;
+    while (fuzzy->busy > 0) {
+        cnd_wait(&fuzzy->idle, &fuzzy->mutex);
+    }
+    mtx_unlock(&fuzzy->mutex);
+}
+
+static void fuzzy_start_workers(Fuzzy *fuzzy) {
+    if (mtx_init(&fuzzy->mutex, mtx_plain) != thrd_success
+        || cnd_init(&fuzzy->work) != thrd_success
+        || cnd_init(&fuzzy->idle) != thrd_success) {
+        fprintf(stderr, "Error: could not create the fuzzy matcher locks\n");
+        exit(1);
+    }
+    size_t worker_count = CLAMP(get_cpu_count(), 1, FUZZY_MAX_WORKERS);
+    for (size_t i = 0; i < worker_count; ++i) {
+        if (thrd_create(&fuzzy->workers[i], fuzzy_worker, fuzzy) != thrd_success) {
+            fprintf(stderr, "Error: could not start the fuzzy matcher workers\n");
+            exit(1);
+        }
+        fuzzy->worker_count += 1;
+    }
+}
+
+void fuzzy_begin(Fuzzy *fuzzy, TODO_App *app) {
+    if (fuzzy->worker_count == 0) {
+        fuzzy_start_workers(fuzzy);
+    }
+    fuzzy_cancel(fuzzy);
+    // NOTE(nic): the workers call app_entry() concurrently, so every page of the
+    // snapshot has to be filled before they see the ids
+    app_load_all_entries(app);
+
+    size_t id_count = app->lists[TODO_LIST_TODOS].count + app->lists[TODO_LIST_DONES].count;
+    if (id_count > fuzzy->id_capacity) {
+        pool_free(&fuzzy->pool, fuzzy->ids, fuzzy->id_capacity*sizeof(*fuzzy->ids));
+        fuzzy->ids = pool_alloc(&fuzzy->pool, id_count*sizeof(*fuzzy->ids));
+        fuzzy->id_capacity = id_count;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < ARRAY_LEN(app->lists); ++i) {
+        List_Iter iter = list_iter_at(&app->lists[i], 0);
+        Entry_Id *id;
+        while (list_iter_next(&iter, &id)) {
+            fuzzy->ids[count++] = *id;
+        }
+    }
+    assert(count == id_count);
+
+    mtx_lock(&fuzzy->mutex);
+    fuzzy->app = app;
+    fuzzy->id_count = id_count;
+    fuzzy->next = id_count;
+    mtx_unlock(&fuzzy->mutex);
+
+    fuzzy->count = 0;
+    fuzzy->matched_shown = 0;
+    fuzzy->done = true;
+    fuzzy->cursor = 0;
+    fuzzy->offset = 0;
+}
+
+void fuzzy_update(Fuzzy *fuzzy, String_View pattern) {
+    fuzzy_cancel(fuzzy);
+
+    pool_free(&fuzzy->pool, fuzzy->pattern, fuzzy->pattern_size);
+    fuzzy->pattern = pool_alloc(&fuzzy->pool, pattern.size);
+    fuzzy->pattern_size = pattern.size;
+    for (size_t i = 0; i < pattern.size; ++i) {
+        fuzzy->pattern[i] = tolower((unsigned char) pattern.data[i]);
+    }
+
+    mtx_lock(&fuzzy->mutex);
+    fuzzy->top_count = 0;
+    fuzzy->scored = 0;
+    fuzzy->matched = 0;
+    fuzzy->changed = true;
+    fuzzy->next = 0;
+    cnd_broadcast(&fuzzy->work);
+    mtx_unlock(&fuzzy->mutex);
+    fuzzy->done = false;
+}
+
+void fuzzy_end(Fuzzy *fuzzy) {
+    fuzzy_cancel(fuzzy);
+    fuzzy->done = true;
+}
+
+bool fuzzy_poll(Fuzzy *fuzzy) {
+    if (fuzzy->worker_count == 0) {
+        return false;
+    }
+    mtx_lock(&fuzzy->mutex);
+    bool changed = fuzzy->changed;
+    if (changed) {
+        memcpy(fuzzy->results, fuzzy->top, fuzzy->top_count*sizeof(*fuzzy->top));
+        fuzzy->count = fuzzy->top_count;
+        fuzzy->matched_shown = fuzzy->matched;
+        fuzzy->done = fuzzy->scored >= fuzzy->id_count;
+        fuzzy->changed = false;
+    }
+    mtx_unlock(&fuzzy->mutex);
+
+    if (changed) {
+        qsort(fuzzy->results, fuzzy->count, sizeof(*fuzzy->results), match_compare);
+        fuzzy->cursor = MIN(fuzzy->cursor, fuzzy->count > 0 ? fuzzy->count - 1 : 0);
+    }
+    return changed;
+}
+
+int fuzzy_timeout(Fuzzy *fuzzy) {
+    return fuzzy->done ? -1 : FUZZY_REFRESH_MS;
+}
@@ -0,0 +1,101 @@
+#ifndef FUZZY_H_
+#define FUZZY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+
+#include "./utils.h"
+#include "./pool.h"
+
+// Defined in todo.h
+typedef struct TODO_App TODO_App;
+
+#define FUZZY_TOP_K 256
+#define FUZZY_MAX_WORKERS 8
+// Entries a worker scores before publishing its matches and checking for cancellation
+#define FUZZY_BATCH 2048
+// How often the main loop picks up new matches while a pass is running
+#define FUZZY_REFRESH_MS 16
+
+// Scores in the style of fzf: every matched character is worth FUZZY_SCORE_MATCH plus
+// a bonus for where it sits, and the gaps between the matched characters cost
+#define FUZZY_SCORE_MATCH 16
+#define FUZZY_GAP_START -3
+#define FUZZY_GAP_EXTENSION -1
+#define FUZZY_BONUS_BOUNDARY 8
+#define FUZZY_BONUS_CAMEL 7
+#define FUZZY_BONUS_CONSECUTIVE 4
+#define FUZZY_BONUS_FIRST_MULT 2
+
+typedef struct {
+    int score;
+    uint32_t size;
+    // Position in the todos followed by the dones, the last tie breaker
+    uint32_t position;
+    uint32_t id;
+} Fuzzy_Match;
+
+// NOTE(nic): A pass scores the (lowercased) pattern against the todos and the dones
+// on a pool of worker threads. The ids of both lists are copied once when the mode
+// starts and cut into batches the workers take one at a time, each batch ends by
+// merging the best matches of the batch into the shared top FUZZY_TOP_K, so the best
+// ones so far are there to draw long before the last batch is done.
+// A new pattern cancels the pass: no more batches are handed out and the batches in
+// flight are thrown away once they finish.
+// The entries are only read by the workers, nothing may change them while the mode
+// is active (the app skips compacting its pool for as long).
+typedef struct {
+    mtx_t mutex;
+    cnd_t work;
+    cnd_t idle;
+    thrd_t workers[FUZZY_MAX_WORKERS];
+    // Started on the first use and left running until the app exits
+    size_t worker_count;
+
+    // Owned by the main thread, read by the workers during a pass
+    Pool pool;
+    TODO_App *app;
+    uint32_t *ids;
+    size_t id_count;
+    size_t id_capacity;
+    char *pattern;
+    size_t pattern_size;
+
+    // Under the mutex
+    uint64_t generation;
+    size_t next;
+    size_t busy;
+    size_t scored;
+    size_t matched;
+    bool changed;
+    // Min-heap on the ranking, the worst of the best is on top
+    Fuzzy_Match top[FUZZY_TOP_K];
+    size_t top_count;
+
+    // Main thread only, the best first
+    Fuzzy_Match results[FUZZY_TOP_K];
+    size_t count;
+    size_t matched_shown;
+    bool done;
+    size_t cursor;
+    size_t offset;
+} Fuzzy;
+
+// Matches `pattern` (lowercase) against `text` ignoring ASCII case, false if the
+// characters of the pattern do not all appear in order
+bool fuzzy_score(String_View text, String_View pattern, int *score);
+
+// Takes a snapshot of both lists of the app, starting the workers the first time
+void fuzzy_begin(Fuzzy *fuzzy, TODO_App *app);
+// Cancels the pass in flight and starts scoring `pattern`
+void fuzzy_update(Fuzzy *fuzzy, String_View pattern);
+// Cancels the pass in flight and waits until no worker reads the entries anymore
+void fuzzy_end(Fuzzy *fuzzy);
+// Copies the matches published since the last call into `results`
+bool fuzzy_poll(Fuzzy *fuzzy);
+// -1 when no pass is running
+int fuzzy_timeout(Fuzzy *fuzzy);
+
+#endif // FUZZY_H_
@@ -0,0 +1,298 @@
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#    include <unistd.h>
+#elif _WIN32
+#    include <windows.h>
+#    include <conio.h>
+#else
+#    error "OS not supported"
+#endif
+
+#include "./input.h"
+#include "./plat.h"
+
+#define PASTE_END "\033[201~"
+
+static size_t input_count(Input *input) {
+    return input->tail - input->head;
+}
+
+static char input_peek(Input *input, size_t i) {
+    return input->items[(input->head + i) & (INPUT_RING_CAPACITY - 1)];
+}
+
+static void input_consume(Input *input, size_t n) {
+    input->head += n;
+}
+
+static bool input_starts_with(Input *input, const char *prefix, size_t prefix_size) {
+    if (input_count(input) < prefix_size) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix_size; ++i) {
+        if (input_peek(input, i) != prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t input_fill(Input *input) {
+    size_t total = 0;
+    while (input_count(input) < INPUT_RING_CAPACITY) {
+        size_t start = input->tail & (INPUT_RING_CAPACITY - 1);
+        size_t space = INPUT_RING_CAPACITY - input_count(input);
+        size_t contiguous = MIN(space, INPUT_RING_CAPACITY - start);
+#ifdef __linux__
+        ssize_t n = read(STDIN_FILENO, input->items + start, contiguous);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0) {
+            input->eof = true;
+            break;
+        }
+        if (n < 0) {
+            break;
+        }
+#elif _WIN32
+        size_t n = 0;
+        while (n < contiguous && _kbhit()) {
+            input->items[start + n++] = _getch();
+        }
+        if (n == 0) {
+            break;
+        }
+#endif
+        input->tail += n;
+        total += n;
+    }
+    return total;
+}
+
+size_t input_feed(Input *input, const char *data, size_t size) {
+    size_t n = MIN(size, INPUT_RING_CAPACITY - input_count(input));
+    for (size_t i = 0; i < n; ++i) {
+        input->items[(input->tail + i) & (INPUT_RING_CAPACITY - 1)] = data[i];
+    }
+    input->tail += n;
+    return n;
+}
+
+// Moves pasted bytes out of the ring until the end marker, true once it was seen
+static bool input_take_paste(Input *input) {
+    while (input_count(input) > 0) {
+        if (input_peek(input, 0) == '\033') {
+            if (input_count(input) < sizeof(PASTE_END) - 1) {
+                // NOTE(nic): might be the beginning of the end marker
+                return false;
+            }
+            if (input_starts_with(input, PASTE_END, sizeof(PASTE_END) - 1)) {
+                input_consume(input, sizeof(PASTE_END) - 1);
+                return true;
+            }
+        }
+        char ch = input_peek(input, 0);
+        str_append_char(&input->arena, &input->paste, ch);
+        input_consume(input, 1);
+    }
+    return false;
+}
+
+typedef struct {
+    char final;
+    // First parameter of the sequence, only checked for `~` sequences
+    int param;
+    int been;
+} Sequence_Key;
+
+// NOTE(nic): xterm, VT220 and rxvt flavours of the same keys, `\033[<param>~`
+// sequences are told apart by the parameter and the rest by the final byte
+static const Sequence_Key csi_keys[] = {
+    { 'A', 0, BEEN_UP },
+    { 'B', 0, BEEN_DOWN },
+    { 'C', 0, BEEN_RIGHT },
+    { 'D', 0, BEEN_LEFT },
+    { 'H', 0, BEEN_HOME },
+    { 'F', 0, BEEN_END },
+    { '~', 1, BEEN_HOME },
+    { '~', 2, BEEN_INSERT },
+    { '~', 3, BEEN_DELETE },
+    { '~', 4, BEEN_END },
+    { '~', 5, BEEN_PAGE_UP },
+    { '~', 6, BEEN_PAGE_DOWN },
+    { '~', 7, BEEN_HOME },
+    { '~', 8, BEEN_END },
+};
+
+static const Sequence_Key ss3_keys[] = {
+    { 'A', 0, BEEN_UP },
+    { 'B', 0, BEEN_DOWN },
+    { 'C', 0, BEEN_RIGHT },
+    { 'D', 0, BEEN_LEFT },
+    { 'H', 0, BEEN_HOME },
+    { 'F', 0, BEEN_END },
+};
+
+static int lookup_key(const Sequence_Key *keys, size_t count, char final, int param) {
+    for (size_t i = 0; i < count; ++i) {
+        if (keys[i].final == final && (final != '~' || keys[i].param == param)) {
+            return keys[i].been;
+        }
+    }
+    return BEEN_UNKNOWN;
+}
+
+// xterm sends modifiers as the second parameter, 1 + shift|alt<<1|ctrl<<2
+static int decode_modifiers(int param) {
+    int been = 0;
+    if (param < 2) {
+        return been;
+    }
+    param -= 1;
+    if (param & 1) been |= BEEN_MOD_SHIFT;
+    if (param & 2) been |= BEEN_MOD_ALT;
+    if (param & 4) been |= BEEN_MOD_CTRL;
+    return been;
+}
+
+static int decode_byte(char ch) {
+    if (ch == '\n' || ch == '\r') {
+        return BEEN_ENTER;
+    } else if (ch == 127 || ch == 8) {
+        return BEEN_BACKSPACE;
+    } else if ((unsigned char) ch < 32) {
+        return BEEN_UNKNOWN;
+    }
+    return (unsigned char) ch;
+}
+
+// Decodes the sequence at the start of the ring, which starts with ESC.
+// Returns its size, 0 if it is not complete yet.
+static size_t decode_escape(Input *input, int *been) {
+    size_t count = input_count(input);
+    if (count < 2) {
+        return 0;
+    }
+    char kind = input_peek(input, 1);
+    if (kind == 'O') {
+        if (count < 3) {
+            return 0;
+        }
+        *been = lookup_key(ss3_keys, ARRAY_LEN(ss3_keys), input_peek(input, 2), 0);
+        return 3;
+    }
+    if (kind != '[') {
+        // NOTE(nic): terminals send Alt+key as ESC followed by the key
+        if (kind == '\033') {
+            *been = BEEN_ESC;
+            return 1;
+        }
+        *been = decode_byte(kind) | BEEN_MOD_ALT;
+        return 2;
+    }
+
+    int params[2] = {0};
+    size_t param_count = 0;
+    bool private = false;
+    for (size_t i = 2; i < count; ++i) {
+        char ch = input_peek(input, i);
+        if (ch >= '0' && ch <= '9') {
+            if (param_count < ARRAY_LEN(params) && params[param_count] < 10000) {
+                params[param_count] = params[param_count]*10 + (ch - '0');
+            }
+        } else if (ch == ';') {
+            param_count += 1;
+        } else if (ch >= 0x20 && ch <= 0x3F) {
+            // NOTE(nic): private markers and intermediates, nothing we know uses them
+            private = true;
+        } else if (ch >= 0x40 && ch <= 0x7E) {
+            if (ch == '~' && params[0] == 200 && i == 5) {
+                *been = BEEN_PASTE;
+                return i + 1;
+            }
+            *been = private
+                ? BEEN_UNKNOWN
+                : lookup_key(csi_keys, ARRAY_LEN(csi_keys), ch, params[0]);
+            if (*been != BEEN_UNKNOWN) {
+                *been |= decode_modifiers(params[1]);
+            }
+            return i + 1;
+        } else {
+            // NOTE(nic): not a valid CSI byte, drop what we have so far
+            *been = BEEN_UNKNOWN;
+            return i;
+        }
+        if (i + 1 >= INPUT_MAX_SEQUENCE) {
+            *been = BEEN_UNKNOWN;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static uint64_t input_pending_ms(Input *input) {
+    return (get_time_ns() - input->pending_since_ns)/1000000;
+}
+
+bool input_next(Input *input, Input_Event *event) {
+    if (!input->pasting) {
+        input->paste.count = 0;
+    }
+    if (input->pasting) {
+        if (!input_take_paste(input)) {
+            return false;
+        }
+        input->pasting = false;
+        event->been = BEEN_PASTE;
+        event->text = sv_from_parts(input->paste.items, input->paste.count);
+        return true;
+    }
+
+    if (input_count(input) == 0) {
+        input->pending = false;
+        return false;
+    }
+    char ch = input_peek(input, 0);
+    int been = decode_byte(ch);
+    size_t size = 1;
+    if (ch == '\033') {
+        size = decode_escape(input, &been);
+        if (size == 0) {
+            // NOTE(nic): either the rest of the sequence is still on its way or this is
+            // the ESC key itself, only time can tell
+            if (!input->pending) {
+                input->pending = true;
+                input->pending_since_ns = get_time_ns();
+            }
+            if (input_pending_ms(input) < (uint64_t) input->escape_timeout_ms) {
+                return false;
+            }
+            been = BEEN_ESC;
+            size = 1;
+        }
+    }
+    input->pending = false;
+    input_consume(input, size);
+
+    if (been == BEEN_PASTE) {
+        input->pasting = true;
+        return input_next(input, event);
+    }
+    event->been = been;
+    event->text = sv_from_parts(NULL, 0);
+    return true;
+}
+
+int input_timeout(Input *input) {
+    if (!input->pending) {
+        return -1;
+    }
+    uint64_t elapsed = input_pending_ms(input);
+    if (elapsed >= (uint64_t) input->escape_timeout_ms) {
+        return 0;
+    }
+    return input->escape_timeout_ms - elapsed;
+}
@@ -0,0 +1,82 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "./arena.h"
+#include "./utils.h"
+
+// Must be a power of two
+#define INPUT_RING_CAPACITY (64*1024)
+
+// How long an ESC waits for the rest of a sequence before it counts as the ESC key.
+// Terminals send a whole sequence in one write, but a slow link can split it.
+#define INPUT_ESCAPE_TIMEOUT_MS 50
+// Sequences longer than this are garbage and get dropped as BEEN_UNKNOWN
+#define INPUT_MAX_SEQUENCE 32
+
+typedef enum {
+    BEEN_PRINTABLE_LAST = 255,
+    BEEN_UP,
+    BEEN_DOWN,
+    BEEN_LEFT,
+    BEEN_RIGHT,
+    BEEN_ENTER,
+    BEEN_BACKSPACE,
+    BEEN_DELETE,
+    BEEN_INSERT,
+    BEEN_HOME,
+    BEEN_END,
+    BEEN_PAGE_UP,
+    BEEN_PAGE_DOWN,
+    BEEN_ESC,
+    BEEN_PASTE,
+    BEEN_UNKNOWN,
+    BEEN_NONE,
+} Been;
+
+// NOTE(nic): Modifiers are or'ed on top of the key, so a plain `been == BEEN_UP`
+// does not match Ctrl+Up. Use `BEEN_KEY()` to ignore them.
+#define BEEN_MOD_SHIFT (1 << 16)
+#define BEEN_MOD_ALT   (1 << 17)
+#define BEEN_MOD_CTRL  (1 << 18)
+#define BEEN_KEY(been) ((been) & 0xFFFF)
+
+typedef struct {
+    int been;
+    // BEEN_PASTE only, valid until the next `input_next()`
+    String_View text;
+} Input_Event;
+
+// NOTE(nic): Bytes are read from the terminal in chunks into a ring buffer and decoded
+// from there. A sequence that is split across reads stays in the ring until the rest of
+// it arrives. Bracketed paste content is moved out of the ring as it comes in, so a
+// paste of any size is delivered as one BEEN_PASTE event.
+typedef struct {
+    char items[INPUT_RING_CAPACITY];
+    size_t head;
+    size_t tail;
+    bool eof;
+
+    Arena arena;
+    bool pasting;
+    String paste;
+
+    // Set when the ring starts with an incomplete escape sequence
+    bool pending;
+    uint64_t pending_since_ns;
+    int escape_timeout_ms;
+} Input;
+
+// Reads everything that is available without blocking, returns the amount of bytes read
+size_t input_fill(Input *input);
+// Takes bytes from somewhere else than the terminal, returns how many of them fit
+size_t input_feed(Input *input, const char *data, size_t size);
+// Decodes the next complete event, false if there is none (yet)
+bool input_next(Input *input, Input_Event *event);
+// Milliseconds until a pending escape sequence resolves on its own, -1 if there is none
+int input_timeout(Input *input);
+
+#endif // INPUT_H_
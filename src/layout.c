@@ -0,0 +1,198 @@
+#include <assert.h>
+#include <string.h>
+
+#include "./layout.h"
+#include "./unicode.h"
+
+static void layout_release_lines(Layout_Cache *cache, Entry_Layout *layout) {
+    if (layout->lines != NULL) {
+        pool_free(&cache->pool, layout->lines, layout->line_count*sizeof(*layout->lines));
+    }
+    layout->lines = NULL;
+    layout->line_count = 0;
+    layout->wrap_width = 0;
+}
+
+static void layout_release(Layout_Cache *cache, Entry_Layout *layout) {
+    if (layout->columns != NULL) {
+        pool_free(&cache->pool, layout->columns, (layout->width + 1)*sizeof(*layout->columns));
+    }
+    layout_release_lines(cache, layout);
+    *layout = (Entry_Layout) {0};
+}
+
+static bool is_ascii(String_View text) {
+    for (size_t i = 0; i < text.size; ++i) {
+        unsigned char ch = text.data[i];
+        if (ch < 32 || ch >= 127) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Entry_Layout *layout_find(Layout_Cache *cache, uint32_t id) {
+    Entry_Layout *set = &cache->slots[(id % LAYOUT_CACHE_SETS)*LAYOUT_CACHE_WAYS];
+    for (size_t way = 0; way < LAYOUT_CACHE_WAYS; ++way) {
+        if (set[way].key == id + 1) {
+            return &set[way];
+        }
+    }
+    return NULL;
+}
+
+// The slot of the set `id` goes to that is empty or was asked for the longest ago
+static Entry_Layout *layout_victim(Layout_Cache *cache, uint32_t id) {
+    Entry_Layout *set = &cache->slots[(id % LAYOUT_CACHE_SETS)*LAYOUT_CACHE_WAYS];
+    Entry_Layout *victim = &set[0];
+    for (size_t way = 0; way < LAYOUT_CACHE_WAYS; ++way) {
+        if (set[way].key == 0) {
+            return &set[way];
+        }
+        // NOTE(nic): the difference stays right when the tick wraps around
+        if (cache->tick - set[way].used > cache->tick - victim->used) {
+            victim = &set[way];
+        }
+    }
+    return victim;
+}
+
+Entry_Layout *layout_get(Layout_Cache *cache, uint32_t id, String_View text) {
+    cache->tick += 1;
+    Entry_Layout *layout = layout_find(cache, id);
+    if (layout != NULL && layout->text == text.data && layout->size == text.size) {
+        layout->used = cache->tick;
+        return layout;
+    }
+    if (layout == NULL) {
+        layout = layout_victim(cache, id);
+    }
+    layout_release(cache, layout);
+    layout->key = id + 1;
+    layout->used = cache->tick;
+    layout->text = text.data;
+    layout->size = text.size;
+    if (is_ascii(text)) {
+        layout->width = text.size;
+        return layout;
+    }
+
+    layout->width = text_width(text.data, text.size);
+    layout->columns = pool_alloc(&cache->pool, (layout->width + 1)*sizeof(*layout->columns));
+    size_t col = 0;
+    size_t filled = 0;
+    size_t i = 0;
+    while (i < text.size) {
+        size_t width;
+        size_t n = grapheme_next(text.data + i, text.size - i, &width);
+        // NOTE(nic): the second column of a wide cluster points to the cluster after it
+        while (filled <= col) {
+            layout->columns[filled++] = i;
+        }
+        col += width;
+        i += n;
+    }
+    assert(col == layout->width);
+    while (filled <= col) {
+        layout->columns[filled++] = text.size;
+    }
+    return layout;
+}
+
+void layout_forget(Layout_Cache *cache, uint32_t id) {
+    Entry_Layout *layout = layout_find(cache, id);
+    if (layout != NULL) {
+        layout_release(cache, layout);
+    }
+}
+
+void layout_reset(Layout_Cache *cache) {
+    for (size_t i = 0; i < LAYOUT_CACHE_SIZE; ++i) {
+        layout_release(cache, &cache->slots[i]);
+    }
+}
+
+size_t layout_offset(Entry_Layout *layout, size_t col) {
+    col = MIN(col, layout->width);
+    if (layout->columns == NULL) {
+        return col;
+    }
+    return layout->columns[col];
+}
+
+// Counts the lines of `text` wrapped at `width` columns and, unless `lines` is NULL,
+// stores the byte offset each of them starts at
+static size_t wrap_lines(String_View text, size_t width, uint32_t *lines) {
+    size_t count = 1;
+    size_t start = 0;
+    size_t cols = 0;
+    // Right after the last space of the line, where it breaks when a word does not fit
+    size_t space = 0;
+    size_t space_cols = 0;
+    size_t i = 0;
+    while (i < text.size) {
+        size_t w;
+        size_t n = grapheme_next(text.data + i, text.size - i, &w);
+        if (text.data[i] == ' ') {
+            // NOTE(nic): spaces never break a line themselves, the ones at the end of a
+            // line hang past the edge where nobody sees them
+            cols += w;
+            i += n;
+            space = i;
+            space_cols = cols;
+            continue;
+        }
+        if (cols + w > width && cols > 0) {
+            if (space > start) {
+                start = space;
+                cols -= space_cols;
+            } else {
+                // A word longer than the line is broken between two clusters
+                start = i;
+                cols = 0;
+            }
+            if (lines != NULL) {
+                lines[count] = start;
+            }
+            count += 1;
+        }
+        cols += w;
+        i += n;
+    }
+    return count;
+}
+
+Entry_Layout *layout_wrap(Layout_Cache *cache, uint32_t id, String_View text, size_t width) {
+    Entry_Layout *layout = layout_get(cache, id, text);
+    width = MAX(width, 1);
+    if (layout->wrap_width == width) {
+        return layout;
+    }
+    layout_release_lines(cache, layout);
+    layout->wrap_width = width;
+    if (layout->width <= width) {
+        layout->line_count = 1;
+        return layout;
+    }
+    layout->line_count = wrap_lines(text, width, NULL);
+    layout->lines = pool_alloc(&cache->pool, layout->line_count*sizeof(*layout->lines));
+    layout->lines[0] = 0;
+    wrap_lines(text, width, layout->lines);
+    return layout;
+}
+
+String_View layout_line(Entry_Layout *layout, size_t line) {
+    assert(line < layout->line_count);
+    if (layout->lines == NULL) {
+        return sv_from_parts(layout->text, layout->size);
+    }
+    size_t start = layout->lines[line];
+    size_t end = layout->size;
+    if (line + 1 < layout->line_count) {
+        end = layout->lines[line + 1];
+        while (end > start && layout->text[end - 1] == ' ') {
+            end -= 1;
+        }
+    }
+    return sv_from_parts(layout->text + start, end - start);
+}
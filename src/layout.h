@@ -0,0 +1,63 @@
+#ifndef LAYOUT_H_
+#define LAYOUT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "./utils.h"
+#include "./pool.h"
+
+// Slots of the cache, an entry id can go to any of the LAYOUT_CACHE_WAYS slots of set
+// `id % LAYOUT_CACHE_SETS`. The wrapped view keeps every entry on screen in the cache,
+// so this is well above the rows of a big terminal.
+#define LAYOUT_CACHE_WAYS 4
+#define LAYOUT_CACHE_SETS 128
+#define LAYOUT_CACHE_SIZE (LAYOUT_CACHE_WAYS*LAYOUT_CACHE_SETS)
+
+typedef struct {
+    // Entry id plus one, 0 marks an empty slot
+    uint32_t key;
+    // Tick of the cache when the slot was last asked for, the oldest of a set goes first
+    uint32_t used;
+    const char *text;
+    uint32_t size;
+    // Columns of the whole text
+    uint32_t width;
+    // Byte offset of the first cluster that starts at column i or later, `width + 1`
+    // of them. NULL when every byte is one column and the offsets are the columns.
+    uint32_t *columns;
+
+    // Lines of the text wrapped at `wrap_width` columns, 0 until it is wrapped once
+    uint32_t wrap_width;
+    uint32_t line_count;
+    // Byte offset each line starts at, NULL when it is a single line
+    uint32_t *lines;
+} Entry_Layout;
+
+// NOTE(nic): Decoding the text of an entry into clusters and their widths is only
+// needed where more than the first screen width of it matters, like the scrolling of
+// the selected entry or breaking it into lines. The result is cached per entry so that
+// happens once and not every frame. Entries are keyed by id and text pointer, the app
+// forgets an entry when its text changes since a new text can land where an old one
+// was. Visible ids are far from contiguous once entries move between the lists, so a
+// set holds a few of them and evicts the least recently used one. Up to
+// LAYOUT_CACHE_WAYS entries on screen can share a set before they start evicting
+// each other.
+typedef struct {
+    Pool pool;
+    uint32_t tick;
+    Entry_Layout slots[LAYOUT_CACHE_SIZE];
+} Layout_Cache;
+
+Entry_Layout *layout_get(Layout_Cache *cache, uint32_t id, String_View text);
+void layout_forget(Layout_Cache *cache, uint32_t id);
+void layout_reset(Layout_Cache *cache);
+// Byte offset of the first cluster that starts at column `col` or later
+size_t layout_offset(Entry_Layout *layout, size_t col);
+// Breaks the text into lines of at most `width` columns, at spaces where possible. The
+// lines stay cached until the text changes or they are asked for at another width.
+Entry_Layout *layout_wrap(Layout_Cache *cache, uint32_t id, String_View text, size_t width);
+String_View layout_line(Entry_Layout *layout, size_t line);
+
+#endif // LAYOUT_H_
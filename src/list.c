@@ -0,0 +1,265 @@
+#include <assert.h>
+#include <string.h>
+
+#include "./list.h"
+
+#define LIST_DIRECTORY_INIT_CAP 16
+
+static size_t lowbit(size_t i) {
+    return i & (~i + 1);
+}
+
+// Sum of the counts of the first `n` chunks
+static size_t list_tree_prefix(List *list, size_t n) {
+    size_t sum = 0;
+    for (size_t i = n; i > 0; i -= lowbit(i)) {
+        sum += list->tree[i];
+    }
+    return sum;
+}
+
+// NOTE(nic): `delta` wraps around, adding SIZE_MAX subtracts one
+static void list_tree_add(List *list, size_t chunk, size_t delta) {
+    for (size_t i = chunk + 1; i <= list->chunk_count; i += lowbit(i)) {
+        list->tree[i] += delta;
+    }
+}
+
+static size_t list_chunk_count(List *list, size_t chunk) {
+    if (list->chunks[chunk] == NULL) {
+        return list->ranges[chunk].count;
+    }
+    return list->chunks[chunk]->count;
+}
+
+// Writes out the ids of a range, the chunk is about to change
+static List_Chunk *list_fill_chunk(Pool *pool, List *list, size_t chunk) {
+    if (list->chunks[chunk] == NULL) {
+        List_Range range = list->ranges[chunk];
+        List_Chunk *filled = pool_alloc(pool, sizeof(List_Chunk));
+        filled->count = range.count;
+        for (size_t i = 0; i < range.count; ++i) {
+            filled->items[i] = range.first + i;
+        }
+        list->chunks[chunk] = filled;
+    }
+    return list->chunks[chunk];
+}
+
+static void list_tree_rebuild(List *list) {
+    for (size_t i = 1; i <= list->chunk_count; ++i) {
+        list->tree[i] = list_chunk_count(list, i - 1);
+    }
+    for (size_t i = 1; i <= list->chunk_count; ++i) {
+        size_t j = i + lowbit(i);
+        if (j <= list->chunk_count) {
+            list->tree[j] += list->tree[i];
+        }
+    }
+}
+
+// Finds the chunk holding entry `index`, `slot` receives its position in that chunk
+static size_t list_find(List *list, size_t index, size_t *slot) {
+    assert(index < list->count);
+    size_t step = 1;
+    while (step*2 <= list->chunk_count) {
+        step *= 2;
+    }
+    size_t chunk = 0;
+    for (; step > 0; step /= 2) {
+        if (chunk + step <= list->chunk_count && list->tree[chunk + step] <= index) {
+            chunk += step;
+            index -= list->tree[chunk];
+        }
+    }
+    *slot = index;
+    return chunk;
+}
+
+// Makes room for a chunk in the directory and leaves its slot NULL, the tree is up
+// to the caller
+static void list_insert_slot(Pool *pool, List *list, size_t chunk) {
+    if (list->chunk_count >= list->chunk_capacity) {
+        size_t old_capacity = list->chunk_capacity;
+        size_t new_capacity = old_capacity == 0 ? LIST_DIRECTORY_INIT_CAP : old_capacity*2;
+        list->chunks = pool_realloc(pool, list->chunks,
+                                    old_capacity*sizeof(*list->chunks),
+                                    new_capacity*sizeof(*list->chunks));
+        list->tree = pool_realloc(pool, list->tree,
+                                  (old_capacity == 0 ? 0 : old_capacity + 1)*sizeof(*list->tree),
+                                  (new_capacity + 1)*sizeof(*list->tree));
+        if (list->ranges != NULL) {
+            list->ranges = pool_realloc(pool, list->ranges,
+                                        old_capacity*sizeof(*list->ranges),
+                                        new_capacity*sizeof(*list->ranges));
+        }
+        list->chunk_capacity = new_capacity;
+    }
+    memmove(list->chunks + chunk + 1, list->chunks + chunk, (list->chunk_count - chunk)*sizeof(*list->chunks));
+    if (list->ranges != NULL) {
+        memmove(list->ranges + chunk + 1, list->ranges + chunk, (list->chunk_count - chunk)*sizeof(*list->ranges));
+    }
+    list->chunks[chunk] = NULL;
+    list->chunk_count += 1;
+}
+
+static List_Chunk *list_insert_chunk(Pool *pool, List *list, size_t chunk) {
+    list_insert_slot(pool, list, chunk);
+    List_Chunk *new_chunk = pool_alloc(pool, sizeof(List_Chunk));
+    new_chunk->count = 0;
+    list->chunks[chunk] = new_chunk;
+    return new_chunk;
+}
+
+static void list_remove_chunk(Pool *pool, List *list, size_t chunk) {
+    if (list->chunks[chunk] != NULL) {
+        pool_free(pool, list->chunks[chunk], sizeof(List_Chunk));
+    }
+    memmove(list->chunks + chunk, list->chunks + chunk + 1, (list->chunk_count - chunk - 1)*sizeof(*list->chunks));
+    if (list->ranges != NULL) {
+        memmove(list->ranges + chunk, list->ranges + chunk + 1, (list->chunk_count - chunk - 1)*sizeof(*list->ranges));
+    }
+    list->chunk_count -= 1;
+}
+
+// NOTE(nic): a node added at the end covers the chunks before it that its lowbit
+// reaches, none of the existing nodes change
+static void list_tree_push(List *list, size_t count) {
+    size_t n = list->chunk_count;
+    list->tree[n] = list_tree_prefix(list, n - 1) - list_tree_prefix(list, n - lowbit(n));
+    list_tree_add(list, n - 1, count);
+}
+
+List_Item list_at(List *list, size_t index) {
+    size_t slot;
+    size_t chunk = list_find(list, index, &slot);
+    if (list->chunks[chunk] == NULL) {
+        return list->ranges[chunk].first + slot;
+    }
+    return list->chunks[chunk]->items[slot];
+}
+
+void list_append(Pool *pool, List *list, List_Item item) {
+    size_t n = list->chunk_count;
+    if (n == 0 || list_chunk_count(list, n - 1) == LIST_CHUNK_CAPACITY) {
+        list_insert_chunk(pool, list, n);
+        list_tree_push(list, 0);
+        n += 1;
+    }
+    List_Chunk *chunk = list_fill_chunk(pool, list, n - 1);
+    chunk->items[chunk->count++] = item;
+    list_tree_add(list, n - 1, 1);
+    list->count += 1;
+}
+
+void list_append_range(Pool *pool, List *list, List_Item first, size_t count) {
+    while (count > 0) {
+        size_t n = MIN(count, LIST_CHUNK_CAPACITY);
+        size_t chunk = list->chunk_count;
+        list_insert_slot(pool, list, chunk);
+        if (list->ranges == NULL) {
+            list->ranges = pool_alloc(pool, list->chunk_capacity*sizeof(*list->ranges));
+        }
+        list->ranges[chunk] = (List_Range) { first, n };
+        list_tree_push(list, n);
+        list->count += n;
+        first += n;
+        count -= n;
+    }
+}
+
+void list_copy(Pool *pool, List *dst, List *src) {
+    for (size_t i = 0; i < src->chunk_count; ++i) {
+        if (src->chunks[i] == NULL) {
+            list_append_range(pool, dst, src->ranges[i].first, src->ranges[i].count);
+            continue;
+        }
+        for (size_t j = 0; j < src->chunks[i]->count; ++j) {
+            list_append(pool, dst, src->chunks[i]->items[j]);
+        }
+    }
+}
+
+void list_insert(Pool *pool, List *list, size_t index, List_Item item) {
+    if (index == list->count) {
+        list_append(pool, list, item);
+        return;
+    }
+    size_t slot;
+    size_t chunk = list_find(list, index, &slot);
+    list_fill_chunk(pool, list, chunk);
+    if (list->chunks[chunk]->count == LIST_CHUNK_CAPACITY) {
+        // NOTE(nic): split the full chunk in half and insert into whichever half holds `slot`
+        List_Chunk *next = list_insert_chunk(pool, list, chunk + 1);
+        List_Chunk *full = list->chunks[chunk];
+        size_t half = LIST_CHUNK_CAPACITY/2;
+        next->count = LIST_CHUNK_CAPACITY - half;
+        memcpy(next->items, full->items + half, next->count*sizeof(*next->items));
+        full->count = half;
+        list_tree_rebuild(list);
+        if (slot > half) {
+            chunk += 1;
+            slot -= half;
+        }
+    }
+    List_Chunk *target = list->chunks[chunk];
+    memmove(target->items + slot + 1, target->items + slot, (target->count - slot)*sizeof(*target->items));
+    target->items[slot] = item;
+    target->count += 1;
+    list_tree_add(list, chunk, 1);
+    list->count += 1;
+}
+
+List_Item list_remove(Pool *pool, List *list, size_t index) {
+    size_t slot;
+    size_t chunk = list_find(list, index, &slot);
+    List_Chunk *target = list_fill_chunk(pool, list, chunk);
+    List_Item item = target->items[slot];
+    memmove(target->items + slot, target->items + slot + 1, (target->count - slot - 1)*sizeof(*target->items));
+    target->count -= 1;
+    list->count -= 1;
+
+    bool last = chunk + 1 == list->chunk_count;
+    if (target->count == 0) {
+        list_remove_chunk(pool, list, chunk);
+        if (!last) {
+            list_tree_rebuild(list);
+        }
+    } else if (!last && target->count + list_chunk_count(list, chunk + 1) <= LIST_CHUNK_CAPACITY/2) {
+        // NOTE(nic): merge sparse neighbours so the chunks stay at least half full on average
+        List_Chunk *next = list_fill_chunk(pool, list, chunk + 1);
+        memcpy(target->items + target->count, next->items, next->count*sizeof(*next->items));
+        target->count += next->count;
+        list_remove_chunk(pool, list, chunk + 1);
+        list_tree_rebuild(list);
+    } else {
+        list_tree_add(list, chunk, SIZE_MAX);
+    }
+    return item;
+}
+
+List_Iter list_iter_at(List *list, size_t index) {
+    List_Iter iter = { list, list->chunk_count, 0, 0 };
+    if (index < list->count) {
+        iter.chunk = list_find(list, index, &iter.slot);
+    }
+    return iter;
+}
+
+bool list_iter_next(List_Iter *iter, List_Item **item) {
+    List *list = iter->list;
+    while (iter->chunk < list->chunk_count && iter->slot >= list_chunk_count(list, iter->chunk)) {
+        iter->chunk += 1;
+        iter->slot = 0;
+    }
+    if (iter->chunk >= list->chunk_count) {
+        return false;
+    }
+    if (list->chunks[iter->chunk] == NULL) {
+        iter->item = list->ranges[iter->chunk].first + iter->slot++;
+        *item = &iter->item;
+        return true;
+    }
+    *item = &list->chunks[iter->chunk]->items[iter->slot++];
+    return true;
+}
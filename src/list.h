@@ -0,0 +1,76 @@
+#ifndef LIST_H_
+#define LIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "./utils.h"
+#include "./pool.h"
+
+// Lists only hold handles into the entry table of the app, see `Entry_Id` in todo.h
+typedef uint32_t List_Item;
+
+// A chunk together with its count fills exactly one pool class
+#define LIST_CHUNK_SIZE 4096
+#define LIST_CHUNK_CAPACITY ((LIST_CHUNK_SIZE - sizeof(size_t))/sizeof(List_Item))
+
+typedef struct {
+    size_t count;
+    List_Item items[LIST_CHUNK_CAPACITY];
+} List_Chunk;
+
+// Consecutive ids standing in for a chunk that was never filled
+typedef struct {
+    List_Item first;
+    uint32_t count;
+} List_Range;
+
+// NOTE(nic): Entries are kept in fixed-size chunks (an unrolled list) with a directory
+// of chunk pointers and a Fenwick tree over the chunk counts next to it. Finding entry i
+// walks the tree in O(log chunks), inserting and removing only shift entries within
+// one chunk. The directory itself is rebuilt only when a chunk is split or merged
+// away, once every LIST_CHUNK_CAPACITY/2 operations at most.
+// Ids appended with `list_append_range()` take no chunk at all: their slot in the
+// directory stays NULL and `ranges` holds the ids at the same index, until an insert
+// or remove lands in it and it is filled like any other chunk.
+typedef struct {
+    List_Chunk **chunks;
+    // Same capacity as `chunks` once there is a range, NULL before that
+    List_Range *ranges;
+    // 1-based, tree[i] is the entry count of chunks (i - lowbit(i), i]
+    size_t *tree;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t count;
+
+    size_t cursor;
+    size_t offset;
+    // Rows the list was last drawn with, a page for PgUp/PgDn
+    size_t rows;
+} List;
+
+typedef struct {
+    List *list;
+    size_t chunk;
+    size_t slot;
+    // What `list_iter_next()` points to inside of a range
+    List_Item item;
+} List_Iter;
+
+List_Item list_at(List *list, size_t index);
+void list_append(Pool *pool, List *list, List_Item item);
+// Appends the ids `first` to `first + count - 1` without writing them anywhere
+void list_append_range(Pool *pool, List *list, List_Item first, size_t count);
+// Appends the entries of `src` to `dst` in `pool`, ranges stay ranges and the
+// chunks are packed full
+void list_copy(Pool *pool, List *dst, List *src);
+void list_insert(Pool *pool, List *list, size_t index, List_Item item);
+List_Item list_remove(Pool *pool, List *list, size_t index);
+
+// Walks the entries from `index` on, touching only the chunks on the way. `item` is
+// valid until the next call.
+List_Iter list_iter_at(List *list, size_t index);
+bool list_iter_next(List_Iter *iter, List_Item **item);
+
+#endif // LIST_H_
@@ -6,6 +6,8 @@
 #include <errno.h>
 #include <ctype.h>
 #include <assert.h>
+#include <limits.h>
+#include <time.h>
 
 #ifdef __linux__
 #    include <unistd.h>
@@ -16,11 +18,18 @@
 #endif
 
 // TODO(artik): add raylib as a dependency
-// TODO(nic):
-// - completely change the way we do Been :Kapp:
-// - add utf8 support
 
 #include "./utils.h"
+#include "./todo.h"
+#include "./store.h"
+#include "./render.h"
+#include "./input.h"
+#include "./pool.h"
+#include "./unicode.h"
+#include "./bench.h"
+#include "./profile.h"
+#include "./memory.h"
+#include "./scratch.h"
 #define PLAT_IMPLEMENTATION
 #include "./plat.h"
 #define ARENA_IMPLEMENTATION
@@ -29,9 +38,6 @@
 #define SCROLL_EFFECT_SPEED_MULT 4.0f
 #define WAIT_EFFECT_TIME 2.0f
 
-#define max(a, b) (((a) > (b)) ? (a) : (b))
-#define min(a, b) (((a) < (b)) ? (a) : (b))
-#define clamp(v, _min, _max) min(max(v, _min), _max)
 #define ceilf(v) ((int)((v) + 0.5f))
 
 #define delta_time (1.0f/60.0f)
@@ -48,46 +54,6 @@ typedef struct {
     Rect right;
 } Split;
 
-typedef struct {
-    String *items;
-    size_t count;
-    size_t capacity;
-    size_t cursor;
-    size_t offset;
-} List;
-
-typedef struct {
-    char *items;
-    size_t count;
-    size_t capacity;
-    size_t cursor;
-    size_t offset;
-} Line_Edit;
-
-typedef enum {
-    TODO_STATE_IDLE = 0,
-    TODO_STATE_ADD,
-    TODO_STATE_EDIT,
-} TODO_State;
-
-typedef enum {
-    TODO_LIST_TODOS,
-    TODO_LIST_DONES,
-} TODO_List_Index;
-
-typedef struct {
-    List lists[2];
-    TODO_State state;
-
-    // TODO_STATE_IDLE
-    TODO_List_Index list_index;
-    float scroll_effect;
-    float wait_effect;
-
-    // TODO_STATE_ADD
-    Line_Edit line_edit;
-} TODO_App;
-
 Split split_rect(Rect rect) {
     Split split = {0};
     split.left.x = rect.x;
@@ -102,36 +68,32 @@ Split split_rect(Rect rect) {
     return split;
 }
 
-void draw_rect(Rect rect) {
+void draw_rect(Screen *screen, Rect rect) {
     if (rect.w < 3 || rect.h < 3) {
         return;
     }
-    position_cursor(rect.x, rect.y);
-    printf("╔");
-    for (size_t i = 0; i < rect.w - 2; ++i) {
-        printf("═");
-    }
-    printf("╗");
-
-    for (size_t i = 1; i < rect.h; ++i) {
-        position_cursor(rect.x, rect.y + i);
-        printf("║%*s║", (int) (rect.w - 2), " ");
+    size_t right = rect.x + rect.w - 1;
+    size_t bottom = rect.y + rect.h - 1;
+
+    screen_put(screen, rect.x, rect.y, 0x2554, STYLE_DEFAULT);      // ╔
+    screen_put(screen, right, rect.y, 0x2557, STYLE_DEFAULT);       // ╗
+    screen_put(screen, rect.x, bottom, 0x255A, STYLE_DEFAULT);      // ╚
+    screen_put(screen, right, bottom, 0x255D, STYLE_DEFAULT);       // ╝
+    for (size_t x = rect.x + 1; x < right; ++x) {
+        screen_put(screen, x, rect.y, 0x2550, STYLE_DEFAULT);       // ═
+        screen_put(screen, x, bottom, 0x2550, STYLE_DEFAULT);
     }
-
-    position_cursor(rect.x, rect.y + rect.h);
-    printf("╚");
-    for (size_t i = 0; i < rect.w - 2; ++i) {
-        printf("═");
+    for (size_t y = rect.y + 1; y < bottom; ++y) {
+        screen_put(screen, rect.x, y, 0x2551, STYLE_DEFAULT);       // ║
+        screen_put(screen, right, y, 0x2551, STYLE_DEFAULT);
     }
-    printf("╝");
 }
 
-Rect draw_box(Rect rect, const char *title) {
-    draw_rect(rect);
+Rect draw_box(Screen *screen, Rect rect, const char *title) {
+    draw_rect(screen, rect);
     size_t title_len = strlen(title);
     if (title_len <= rect.w - 2) {
-        position_cursor(rect.x + 1, rect.y);
-        printf("%s", title);
+        screen_text(screen, rect.x + 1, rect.y, title, title_len, title_len, STYLE_DEFAULT);
     }
     return (Rect) {
         rect.x + 1,
@@ -141,119 +103,61 @@ Rect draw_box(Rect rect, const char *title) {
     };
 }
 
-typedef enum {
-    BEEN_PRINTABLE_LAST = 255,
-    BEEN_UP,
-    BEEN_DOWN,
-    BEEN_LEFT,
-    BEEN_RIGHT,
-    BEEN_ENTER,
-    BEEN_BACKSPACE,
-    BEEN_DELETE,
-    BEEN_ESC,
-    BEEN_UNKNOWN,
-} Been;
-
-int fgetbeen(FILE *stream) {
-    char ch = fgetc(stream);
-    if (ch == '\n') {
-        return BEEN_ENTER;
-    } else if (ch == 127) {
-        return BEEN_BACKSPACE;
-    } else if (ch == 27) {
-        char buffer[64];
-        buffer[0] = ch;
-        buffer[1] = fgetc(stream);
-        if (buffer[1] == EOF) {
-            return BEEN_ESC;
-        }
-        size_t count = 2;
-        while (!isalpha(buffer[count - 1]) && buffer[count - 1] != '~') {
-            char ch = fgetc(stream);
-            if (ch != EOF) {
-                assert(count < 64);
-                buffer[count++] = ch;
-                fprintf(stderr, "%d\n", buffer[count - 1]);
-            }
-        }
-        if (count == 3) {
-            switch (buffer[2]) {
-            case 65: return BEEN_UP;
-            case 66: return BEEN_DOWN;
-            case 67: return BEEN_RIGHT;
-            case 68: return BEEN_LEFT;
-            }
-        } else if (count == 4) {
-            if (buffer[2] == '3' && buffer[3] == '~') {
-                return BEEN_DELETE;
-            }
-        }
-        return BEEN_UNKNOWN;
-    }
-    if (ch < 32 || ch == 127) {
-        return BEEN_UNKNOWN;
-    }
-    return ch;
-}
+Store store = {0};
+Pool pool = {0};
+bool print_stats = false;
+// Name of the --script or --bench run, the terminal is left alone and the run is reported on exit
+const char *headless = NULL;
+Bench bench = {0};
+#ifdef PROFILE
+// Where the spans go on exit with --trace
+const char *trace_path = NULL;
+#endif
 
 void handle_exit(void) {
-    unprepare_terminal();
-    visible_cursor();
-    delete_page();
-    exit(0);
-}
-
-#ifdef __linux__
-void sigint_handler(int signum) {
-    (void) signum;
-    handle_exit();
-}
-#elif _WIN32
-BOOL WINAPI console_handler(DWORD signal) {
-    if (signal == CTRL_C_EVENT) {
-        handle_exit();
+    store_close(&store);
+    if (headless != NULL) {
+        bench_report(&bench, &pool, headless, stderr);
+    } else {
+        unprepare_terminal();
+        disable_bracketed_paste();
+        visible_cursor();
+        delete_page();
+        term_flush();
     }
-    return false;
-}
-#endif
-
-void limit_cursor(size_t *offset, size_t size, size_t cursor) {
-    if (cursor > *offset + size) {
-        *offset += 1;
-    } else if (cursor < *offset) {
-        *offset -= 1;
+    if (store.error[0] != '\0') {
+        fprintf(stderr, "Error: %s, the last changes may not be saved\n", store.error);
     }
+    if (print_stats) {
+        pool_print_stats(&pool, stderr);
+        memory_print_stats(&pool, stderr);
+    }
+#ifdef PROFILE
+    if (trace_path != NULL) {
+        profile_dump_trace(trace_path);
+    }
+#endif
+    exit(store.error[0] != '\0' ? 1 : 0);
 }
 
-void app_add_entry(Arena *arena, TODO_App *app, TODO_List_Index list_index, const char *todo, size_t todo_len) {
-    List *list = &app->lists[list_index];
-    String entry = {0};
-    str_append_sized(arena, &entry, todo, todo_len);
-    arena_da_append(arena, list, entry);
-    list->cursor = list->count - 1;
-}
-
-String app_delete_entry(TODO_App *app, TODO_List_Index list_index, size_t entry_index) {
-    List *list = &app->lists[list_index];
-    if (list->count <= 0) {
-        return (String) {0};
-    }
-    assert(entry_index < list->count);
-    String entry = list->items[entry_index];
-    arena_da_remove(list, entry_index);
-    list->cursor = clamp(list->cursor, 0, list->count - 1);
-    return entry;
+// NOTE(nic): The offset follows from the cursor and the size of the view directly, so
+// jumping anywhere in a list of any length settles within one frame
+void limit_cursor(size_t *offset, size_t rows, size_t cursor) {
+    if (cursor < *offset || rows == 0) {
+        *offset = cursor;
+    } else if (cursor >= *offset + rows) {
+        *offset = cursor - rows + 1;
+    }
 }
 
-void app_move_entry(Arena *arena, TODO_App *app, TODO_List_Index from_list_index, size_t entry_index) {
-    List *list = &app->lists[from_list_index];
-    if (list->count <= 0) {
-        return;
+// Moves the cursor of the list to `index`, a jump from far away puts it in the middle of the view
+void list_jump(List *list, size_t index) {
+    size_t rows = MAX(list->rows, 1);
+    if (index < list->offset || index >= list->offset + rows) {
+        list->offset = index > rows/2 ? index - rows/2 : 0;
+        list->offset = MIN(list->offset, list->count > rows ? list->count - rows : 0);
     }
-    assert(entry_index < list->count);
-    String entry = app_delete_entry(app, from_list_index, entry_index);
-    TODO_List_Index to_entry_index = !from_list_index;
-    app_add_entry(arena, app, to_entry_index, entry.items, entry.count);
+    list->cursor = index;
 }
 
 void app_reset_effects(TODO_App *app) {
@@ -262,32 +166,36 @@ void app_reset_effects(TODO_App *app) {
 }
 
 bool line_edit_all_whitespace(Line_Edit *line) {
-    for (size_t i = 0; i < line->count; ++i) {
-        if (!isspace(line->items[i])) {
-            return false;
-        }
-    }
-    return true;
+    String_View before = line_edit_before(line);
+    String_View after = line_edit_after(line);
+    return sv_trim(before).size == 0 && sv_trim(after).size == 0;
 }
 
-int line_edit_handle_been(Arena *arena, Line_Edit *line, int been) {
+int update_line_edit(Pool *pool, Line_Edit *line, Input_Event *event) {
+    int been = event->been;
     if (been >= BEEN_PRINTABLE_LAST) {
         switch (been) {
+        // NOTE(nic): the cursor moves and deletes whole clusters, never parts of one
         case BEEN_LEFT: {
-            if (line->cursor > 0) {
-                line->cursor -= 1;
-            }
+            String_View before = line_edit_before(line);
+            line_edit_move_to(line, before.size - grapheme_prev(before.data, before.size));
         } break;
         case BEEN_RIGHT: {
-            if (line->cursor < line->count) {
-                line->cursor += 1;
-            }
+            String_View after = line_edit_after(line);
+            size_t width;
+            line_edit_move_to(line, line_edit_cursor(line) + grapheme_next(after.data, after.size, &width));
+        } break;
+        case BEEN_HOME: {
+            line_edit_move_to(line, 0);
+        } break;
+        case BEEN_END: {
+            line_edit_move_to(line, line_edit_count(line));
         } break;
         case BEEN_ESC: {
             return -1;
         } break;
         case BEEN_ENTER: {
-            if (line->count == 0) {
+            if (line_edit_count(line) == 0) {
                 return -1;
             }
             if (line_edit_all_whitespace(line)) {
@@ -296,14 +204,26 @@ int line_edit_handle_been(Arena *arena, Line_Edit *line, int been) {
             return 1;
         } break;
         case BEEN_BACKSPACE: {
-            if (line->cursor > 0) {
-                arena_da_remove(line, line->cursor - 1);
-                line->cursor -= 1;
-            }
+            String_View before = line_edit_before(line);
+            line_edit_erase_before(line, grapheme_prev(before.data, before.size));
         } break;
         case BEEN_DELETE: {
-            if (line->cursor < line->count) {
-                arena_da_remove(line, line->cursor);
+            String_View after = line_edit_after(line);
+            size_t width;
+            line_edit_erase_after(line, grapheme_next(after.data, after.size, &width));
+        } break;
+        case BEEN_PASTE: {
+            // NOTE(nic): entries are single line, control characters of the paste become spaces
+            String_View text = event->text;
+            size_t start = 0;
+            for (size_t i = 0; i <= text.size; ++i) {
+                if (i == text.size || (unsigned char) text.data[i] < 32 || text.data[i] == 127) {
+                    line_edit_insert(pool, line, text.data + start, i - start);
+                    if (i < text.size) {
+                        line_edit_insert(pool, line, " ", 1);
+                    }
+                    start = i + 1;
+                }
             }
         } break;
         case BEEN_UNKNOWN: {
@@ -311,171 +231,706 @@ int line_edit_handle_been(Arena *arena, Line_Edit *line, int been) {
         } break;
         }
     } else {
-        arena_da_insert(arena, line, line->cursor, been);
-        line->cursor += 1;
+        char ch = been;
+        line_edit_insert(pool, line, &ch, 1);
     }
     return 0;
 }
 
-int update_and_draw_line_edit(Arena *arena, Line_Edit *line, size_t x, size_t w, size_t y) {
-    position_cursor(x, y);
-    const char *a = line->items + line->offset;
-    printf("%.*s", (int) min(line->count - line->offset, w - 1), a);
-
-    int ch = fgetbeen(stdin);
-    int state = line_edit_handle_been(arena, line, ch);
-    limit_cursor(&line->offset, w - 1, line->cursor);
+// NOTE(nic): `line->offset` is the byte where the visible part starts, always at the
+// start of a cluster. It moves forward a cluster at a time until the text before the
+// cursor and the cursor itself fit.
+void draw_line_edit(Screen *screen, Line_Edit *line, size_t x, size_t w, size_t y) {
+    // NOTE(nic): the text is drawn in two pieces around the gap instead of moving it
+    String_View before = line_edit_before(line);
+    String_View after = line_edit_after(line);
+    if (line->offset > before.size) {
+        line->offset = before.size;
+    }
+    size_t cursor_size = 0;
+    size_t cursor_w = 1;
+    if (after.size > 0) {
+        cursor_size = grapheme_next(after.data, after.size, &cursor_w);
+        cursor_w = MAX(cursor_w, 1);
+    }
+    size_t before_w = text_width(before.data + line->offset, before.size - line->offset);
+    while (before_w + cursor_w > w && line->offset < before.size) {
+        size_t width;
+        line->offset += grapheme_next(before.data + line->offset, before.size - line->offset, &width);
+        before_w -= width;
+    }
 
-    position_cursor(x + line->cursor - line->offset, y);
-    set_bg_color(47, 30);
-    if (line->cursor < line->count) {
-        char ch = line->items[line->cursor];
-        printf("%c", ch);
+    size_t cols = screen_text(screen, x, y, before.data + line->offset, before.size - line->offset, w, STYLE_DEFAULT);
+    if (cursor_size > 0) {
+        cols += screen_text(screen, x + cols, y, after.data, cursor_size, w - cols, STYLE_SELECTED);
     } else {
-        printf(" ");
+        screen_put(screen, x + cols, y, ' ', STYLE_SELECTED);
+        cols += 1;
+    }
+    if (cols < w) {
+        screen_text(screen, x + cols, y, after.data + cursor_size, after.size - cursor_size, w - cols, STYLE_DEFAULT);
     }
-    reset_bg_color();
-    return state;
-}
-
-void clear_line_edit(Line_Edit *line) {
-    line->count = 0;
-    line->cursor = 0;
-    line->offset = 0;
 }
 
-void update_and_draw_list(Arena *arena, Rect rect, TODO_App *app, TODO_List_Index list_index) {
-    List *list = &app->lists[list_index];
-
-    if (list_index == app->list_index) {
-        switch (app->state) {
-        case TODO_STATE_IDLE: {
-            int ch = fgetbeen(stdin);
-            if (ch == 'q') {
-                handle_exit();
-            } else if (ch == 'a') {
-                app->state = TODO_STATE_ADD;
-                app_reset_effects(app);
-            } else if (ch == 'e') {
-                String *text = &list->items[list->cursor];
-                arena_da_copy_overwrite(arena, &app->line_edit, text);
-                app->state = TODO_STATE_EDIT;
-                app_reset_effects(app);
-            } else if (ch == 'd') {
-                app_delete_entry(app, app->list_index, list->cursor);
-            } else if (ch == BEEN_ENTER) {
-                app_move_entry(arena, app, app->list_index, list->cursor);
-            } else if (ch == BEEN_UP) {
-                if (list->cursor > 0) {
-                    list->cursor -= 1;
-                }
-                app_reset_effects(app);
-            } else if (ch == BEEN_DOWN) {
-                if (list->cursor < list->count - 1) {
-                    list->cursor += 1;
-                }
-                app_reset_effects(app);
-            } else if (ch == BEEN_RIGHT) {
-                app->list_index = TODO_LIST_DONES;
-                app_reset_effects(app);
-            } else if (ch == BEEN_LEFT) {
-                app->list_index = TODO_LIST_TODOS;
-                app_reset_effects(app);
+void update_list(Pool *pool, TODO_App *app, Input_Event *event) {
+    List *list = &app->lists[app->list_index];
+
+    switch (app->state) {
+    case TODO_STATE_IDLE: {
+        int ch = event->been;
+        if (ch == 'q') {
+            handle_exit();
+        } else if (ch == 'a') {
+            app->state = TODO_STATE_ADD;
+            app_reset_effects(app);
+        } else if (ch == 'e' && list->count > 0) {
+            Entry *entry = app_list_entry(app, app->list_index, list->cursor);
+            line_edit_set(pool, &app->line_edit, entry_text(entry));
+            app->state = TODO_STATE_EDIT;
+            app_reset_effects(app);
+        } else if (ch == '/') {
+            line_edit_clear(&app->line_edit);
+            search_reset(&app->search);
+            search_update(&app->search, app, SV(""));
+            app->state = TODO_STATE_SEARCH;
+            app_reset_effects(app);
+        } else if (ch == 'f') {
+            line_edit_clear(&app->line_edit);
+            fuzzy_begin(&app->fuzzy, app);
+            fuzzy_update(&app->fuzzy, SV(""));
+            app->state = TODO_STATE_FUZZY;
+            app_reset_effects(app);
+        } else if (ch == 'w') {
+            app->wrap = !app->wrap;
+            app_reset_effects(app);
+#ifdef PROFILE
+        } else if (ch == 'p') {
+            profile.overlay = !profile.overlay;
+#endif
+        } else if (ch == 'd') {
+            app_delete_entry(pool, app, app->list_index, list->cursor);
+        } else if (ch == BEEN_ENTER) {
+            app_move_entry(pool, app, app->list_index, list->cursor, time(NULL));
+        } else if (ch == BEEN_UP) {
+            if (list->cursor > 0) {
+                list->cursor -= 1;
             }
-        } break;
-        case TODO_STATE_ADD: {
-            int state = update_and_draw_line_edit(arena, &app->line_edit, rect.x, rect.w, rect.y + list->count);
-            if (state != 0) {
-                if (state > 0) {
-                    app_add_entry(arena, app, app->list_index, app->line_edit.items, app->line_edit.count);
-                }
-                clear_line_edit(&app->line_edit);
-                app->state = TODO_STATE_IDLE;
+            app_reset_effects(app);
+        } else if (ch == BEEN_DOWN) {
+            if (list->cursor + 1 < list->count) {
+                list->cursor += 1;
             }
-        } break;
-        case TODO_STATE_EDIT: {
-            int state = update_and_draw_line_edit(arena, &app->line_edit, rect.x, rect.w, rect.y + list->cursor - list->offset);
-            if (state != 0) {
-                if (state > 0) {
-                    //__asm__("int3");
-                    String *line = &list->items[list->cursor];
-                    arena_da_copy_overwrite(arena, line, &app->line_edit);
-                    //__asm__("int3");
+            app_reset_effects(app);
+        } else if (ch == BEEN_PAGE_UP) {
+            // NOTE(nic): a page moves the view along with the cursor, like in a pager
+            size_t page = MAX(list->rows, 1);
+            list->cursor = list->cursor > page ? list->cursor - page : 0;
+            list->offset = list->offset > page ? list->offset - page : 0;
+            app_reset_effects(app);
+        } else if (ch == BEEN_PAGE_DOWN && list->count > 0) {
+            size_t page = MAX(list->rows, 1);
+            list->cursor = MIN(list->cursor + page, list->count - 1);
+            list->offset = MIN(list->offset + page, list->count > page ? list->count - page : 0);
+            app_reset_effects(app);
+        } else if (ch == BEEN_HOME) {
+            list_jump(list, 0);
+            app_reset_effects(app);
+        } else if (ch == BEEN_END && list->count > 0) {
+            list_jump(list, list->count - 1);
+            app_reset_effects(app);
+        } else if (ch == BEEN_RIGHT) {
+            app->list_index = TODO_LIST_DONES;
+            app_reset_effects(app);
+        } else if (ch == BEEN_LEFT) {
+            app->list_index = TODO_LIST_TODOS;
+            app_reset_effects(app);
+        }
+    } break;
+    case TODO_STATE_ADD: {
+        int state = update_line_edit(pool, &app->line_edit, event);
+        if (state != 0) {
+            if (state > 0) {
+                String_View text = line_edit_view(&app->line_edit);
+                app_add_entry(pool, app, app->list_index, text.data, text.size, time(NULL));
+            }
+            line_edit_clear(&app->line_edit);
+            app->state = TODO_STATE_IDLE;
+        }
+    } break;
+    case TODO_STATE_EDIT: {
+        int state = update_line_edit(pool, &app->line_edit, event);
+        if (state != 0) {
+            if (state > 0) {
+                String_View text = line_edit_view(&app->line_edit);
+                app_edit_entry(pool, app, app->list_index, list->cursor, text.data, text.size);
+            }
+            line_edit_clear(&app->line_edit);
+            app->state = TODO_STATE_IDLE;
+        }
+    } break;
+    case TODO_STATE_SEARCH: {
+        Search *search = &app->search;
+        int ch = event->been;
+        if (ch == BEEN_UP) {
+            if (search->cursor > 0) {
+                search->cursor -= 1;
+            }
+        } else if (ch == BEEN_DOWN) {
+            search_fill(search, app, search->cursor + 2);
+            if (search->cursor + 1 < search->count) {
+                search->cursor += 1;
+            }
+        } else if (ch == BEEN_ENTER || ch == BEEN_ESC) {
+            if (ch == BEEN_ENTER && search->count > 0) {
+                // NOTE(nic): the results keep no positions since those shift with every
+                // edit, the selected entry is looked up in its list once
+                Entry_Id selected = search->results[search->cursor];
+                app->list_index = app_entry(app, selected)->flags & ENTRY_DONE ? TODO_LIST_DONES : TODO_LIST_TODOS;
+                List *found = &app->lists[app->list_index];
+                List_Iter iter = list_iter_at(found, 0);
+                Entry_Id *id;
+                for (size_t i = 0; list_iter_next(&iter, &id); ++i) {
+                    if (*id == selected) {
+                        list_jump(found, i);
+                        break;
+                    }
                 }
-                clear_line_edit(&app->line_edit);
-                app->state = TODO_STATE_IDLE;
             }
-        } break;
-        default:
-            assert(0 && "unreachable");
+            line_edit_clear(&app->line_edit);
+            search_reset(search);
+            app->state = TODO_STATE_IDLE;
+            app_reset_effects(app);
+        } else {
+            update_line_edit(pool, &app->line_edit, event);
+            size_t cursor = line_edit_cursor(&app->line_edit);
+            search_update(search, app, line_edit_view(&app->line_edit));
+            line_edit_move_to(&app->line_edit, cursor);
+        }
+    } break;
+    case TODO_STATE_FUZZY: {
+        Fuzzy *fuzzy = &app->fuzzy;
+        int ch = event->been;
+        if (ch == BEEN_UP) {
+            if (fuzzy->cursor > 0) {
+                fuzzy->cursor -= 1;
+            }
+        } else if (ch == BEEN_DOWN) {
+            if (fuzzy->cursor + 1 < fuzzy->count) {
+                fuzzy->cursor += 1;
+            }
+        } else if (ch == BEEN_ENTER || ch == BEEN_ESC) {
+            fuzzy_end(fuzzy);
+            if (ch == BEEN_ENTER && fuzzy->count > 0) {
+                // NOTE(nic): the lists did not change since the snapshot, so the position
+                // of a match is still where the entry is
+                size_t position = fuzzy->results[fuzzy->cursor].position;
+                size_t todos = app->lists[TODO_LIST_TODOS].count;
+                app->list_index = position < todos ? TODO_LIST_TODOS : TODO_LIST_DONES;
+                list_jump(&app->lists[app->list_index], position < todos ? position : position - todos);
+            }
+            line_edit_clear(&app->line_edit);
+            app->state = TODO_STATE_IDLE;
+            app_reset_effects(app);
+        } else {
+            update_line_edit(pool, &app->line_edit, event);
+            size_t cursor = line_edit_cursor(&app->line_edit);
+            fuzzy_update(fuzzy, line_edit_view(&app->line_edit));
+            line_edit_move_to(&app->line_edit, cursor);
+        }
+    } break;
+    default:
+        assert(0 && "unreachable");
+    }
+}
+
+void draw_search(Screen *screen, Rect rect, TODO_App *app) {
+    Search *search = &app->search;
+    if (rect.h < 2) {
+        return;
+    }
+    limit_cursor(&search->offset, rect.h - 1, search->cursor);
+    search_fill(search, app, search->offset + rect.h - 1);
+    for (size_t i = 0; i < rect.h - 1 && search->offset + i < search->count; ++i) {
+        size_t index = search->offset + i;
+        Entry *entry = app_entry(app, search->results[index]);
+        Style style = entry->flags & ENTRY_DONE ? STYLE_DIM : STYLE_DEFAULT;
+        if (index == search->cursor) {
+            style = STYLE_SELECTED;
+        }
+        screen_text(screen, rect.x, rect.y + i, entry->text, entry->size, rect.w, style);
+    }
+    screen_put(screen, rect.x, rect.y + rect.h - 1, '/', STYLE_DEFAULT);
+    draw_line_edit(screen, &app->line_edit, rect.x + 1, rect.w - 1, rect.y + rect.h - 1);
+}
+
+void draw_fuzzy(Screen *screen, Rect rect, TODO_App *app) {
+    Fuzzy *fuzzy = &app->fuzzy;
+    if (rect.h < 2) {
+        return;
+    }
+    limit_cursor(&fuzzy->offset, rect.h - 1, fuzzy->cursor);
+    for (size_t i = 0; i < rect.h - 1 && fuzzy->offset + i < fuzzy->count; ++i) {
+        size_t index = fuzzy->offset + i;
+        Entry *entry = app_entry(app, fuzzy->results[index].id);
+        Style style = entry->flags & ENTRY_DONE ? STYLE_DIM : STYLE_DEFAULT;
+        if (index == fuzzy->cursor) {
+            style = STYLE_SELECTED;
         }
+        screen_text(screen, rect.x, rect.y + i, entry->text, entry->size, rect.w, style);
     }
 
-    limit_cursor(&list->offset, rect.h - 1, list->cursor);
-    for (size_t i = 0; i < list->count - list->offset && i < rect.h; ++i) {
-        String *entry = &list->items[i + list->offset];
-        position_cursor(rect.x, rect.y + i);
-        if (app->state == TODO_STATE_EDIT && list_index == app->list_index && i == list->cursor - list->offset) {
+    char *status = arena_sprintf(&frame_arena, " %zu%s", fuzzy->matched_shown, fuzzy->done ? "" : "...");
+    size_t status_w = MIN(strlen(status), rect.w/2);
+    size_t y = rect.y + rect.h - 1;
+    screen_put(screen, rect.x, y, '>', STYLE_DEFAULT);
+    draw_line_edit(screen, &app->line_edit, rect.x + 1, rect.w - 1 - status_w, y);
+    screen_text(screen, rect.x + rect.w - status_w, y, status, status_w, status_w, STYLE_DIM);
+}
+
+// Rows the entry at `index` takes in the wrapped view, the line edit takes a single one
+size_t entry_rows(TODO_App *app, List *list, size_t index, size_t w, bool active) {
+    if (index >= list->count || (active && app->state == TODO_STATE_EDIT && index == list->cursor)) {
+        return 1;
+    }
+    Entry_Id id = list_at(list, index);
+    return layout_wrap(&app->layout, id, entry_text(app_entry(app, id)), w)->line_count;
+}
+
+// NOTE(nic): Same as limit_cursor, but the entries are measured in rows. Only the
+// entries from the cursor up to a screen above it are looked at, and their lines come
+// from the layout cache after the first frame.
+void limit_cursor_wrapped(TODO_App *app, List *list, Rect rect, size_t cursor, bool active) {
+    if (cursor < list->offset || rect.h == 0) {
+        list->offset = cursor;
+        return;
+    }
+    size_t first = cursor;
+    size_t rows = entry_rows(app, list, cursor, rect.w, active);
+    while (first > list->offset) {
+        size_t above = entry_rows(app, list, first - 1, rect.w, active);
+        if (rows + above > rect.h) {
+            break;
+        }
+        rows += above;
+        first -= 1;
+    }
+    list->offset = first;
+}
+
+void draw_list_wrapped(Screen *screen, Rect rect, TODO_App *app, List *list, bool active) {
+    size_t cursor = active && app->state == TODO_STATE_ADD ? list->count : list->cursor;
+    limit_cursor_wrapped(app, list, rect, cursor, active);
+    List_Iter iter = list_iter_at(list, list->offset);
+    Entry_Id *id;
+    size_t y = 0;
+    size_t shown = 0;
+    for (size_t index = list->offset; y < rect.h && list_iter_next(&iter, &id); ++index) {
+        if (active && app->state == TODO_STATE_EDIT && index == list->cursor) {
+            draw_line_edit(screen, &app->line_edit, rect.x, rect.w, rect.y + y);
+            y += 1;
+            shown += 1;
+            continue;
+        }
+        Style style = active && app->state == TODO_STATE_IDLE && index == list->cursor ? STYLE_SELECTED : STYLE_DEFAULT;
+        Entry_Layout *layout = layout_wrap(&app->layout, *id, entry_text(app_entry(app, *id)), rect.w);
+        size_t line = 0;
+        for (; line < layout->line_count && y < rect.h; ++line, ++y) {
+            String_View text = layout_line(layout, line);
+            screen_text(screen, rect.x, rect.y + y, text.data, text.size, rect.w, style);
+        }
+        if (line == layout->line_count) {
+            shown += 1;
+        }
+    }
+    if (active && app->state == TODO_STATE_ADD && y < rect.h) {
+        draw_line_edit(screen, &app->line_edit, rect.x, rect.w, rect.y + y);
+    }
+    // A page is as many entries as fit on the screen
+    list->rows = MAX(shown, 1);
+}
+
+void draw_list(Screen *screen, Rect rect, TODO_App *app, TODO_List_Index list_index, float dt) {
+    List *list = &app->lists[list_index];
+    bool active = list_index == app->list_index;
+
+    if (active && app->state == TODO_STATE_SEARCH) {
+        draw_search(screen, rect, app);
+        return;
+    }
+    if (active && app->state == TODO_STATE_FUZZY) {
+        draw_fuzzy(screen, rect, app);
+        return;
+    }
+    if (app->wrap) {
+        draw_list_wrapped(screen, rect, app, list, active);
+        return;
+    }
+
+    // NOTE(nic): only the visible rows are ever touched, finding the first one is a walk
+    // down the Fenwick tree of the list no matter how long it is
+    list->rows = rect.h;
+    size_t cursor = active && app->state == TODO_STATE_ADD ? list->count : list->cursor;
+    limit_cursor(&list->offset, rect.h, cursor);
+    List_Iter iter = list_iter_at(list, list->offset);
+    Entry_Id *id;
+    for (size_t i = 0; i < rect.h && list_iter_next(&iter, &id); ++i) {
+        Entry *entry = app_entry(app, *id);
+        if (app->state == TODO_STATE_EDIT && active && i == list->cursor - list->offset) {
             continue;
         }
-        if (app->state == TODO_STATE_IDLE && list_index == app->list_index && i == list->cursor - list->offset) {
-            if (entry->count > rect.w) {
-                if (app->scroll_effect >= entry->count - rect.w) {
-                    app->wait_effect += delta_time;
+        if (app->state == TODO_STATE_IDLE && active && i == list->cursor - list->offset) {
+            Entry_Layout *layout = layout_get(&app->layout, *id, entry_text(entry));
+            if (layout->width > rect.w) {
+                app->animating = true;
+                if (app->scroll_effect >= layout->width - rect.w) {
+                    app->wait_effect += dt;
                     if (app->wait_effect >= WAIT_EFFECT_TIME) {
                         app->scroll_effect = 0.0f;
                         app->wait_effect = 0.0f;
                     }
                 } else {
-                    app->scroll_effect += delta_time * SCROLL_EFFECT_SPEED_MULT;
+                    app->scroll_effect += dt * SCROLL_EFFECT_SPEED_MULT;
+                    app->scroll_effect = MIN(app->scroll_effect, layout->width - rect.w);
                 }
             } else {
                 app->wait_effect = 0.0f;
             }
-            set_bg_color(47, 30);
-            printf("%.*s", (int) min(entry->count, rect.w), entry->items + (size_t) app->scroll_effect);
+            size_t scroll = layout_offset(layout, (size_t) app->scroll_effect);
+            screen_text(screen, rect.x, rect.y + i, entry->text + scroll, entry->size - scroll, rect.w, STYLE_SELECTED);
         } else {
-            printf("%.*s", (int) min(entry->count, rect.w), entry->items);
+            screen_text(screen, rect.x, rect.y + i, entry->text, entry->size, rect.w, STYLE_DEFAULT);
         }
-        reset_bg_color();
+    }
+
+    if (active && app->state == TODO_STATE_ADD) {
+        draw_line_edit(screen, &app->line_edit, rect.x, rect.w, rect.y + list->count - list->offset);
+    } else if (active && app->state == TODO_STATE_EDIT) {
+        draw_line_edit(screen, &app->line_edit, rect.x, rect.w, rect.y + list->cursor - list->offset);
     }
 }
 
-void update_and_draw_todo_app(Arena *arena, TODO_App *app, Split split) {
-    Rect todos_rect = draw_box(split.left, "TODO");
-    Rect dones_rect = draw_box(split.right, "DONE");
+void update_todo_app(Pool *pool, TODO_App *app, Input_Event *event) {
+    update_list(pool, app, event);
+}
 
-    update_and_draw_list(arena, todos_rect, app, TODO_LIST_TODOS);
-    update_and_draw_list(arena, dones_rect, app, TODO_LIST_DONES);
+void draw_todo_app(Screen *screen, TODO_App *app, Split split, float dt) {
+    screen_clear(screen);
+    PROFILE_BEGIN(PROFILE_BOXES);
+    Rect todos_rect = draw_box(screen, split.left, "TODO");
+    Rect dones_rect = draw_box(screen, split.right, "DONE");
+    PROFILE_END(PROFILE_BOXES);
+
+    app->animating = false;
+    PROFILE_BEGIN(PROFILE_LISTS);
+    draw_list(screen, todos_rect, app, TODO_LIST_TODOS, dt);
+    draw_list(screen, dones_rect, app, TODO_LIST_DONES, dt);
+    PROFILE_END(PROFILE_LISTS);
+
+    // NOTE(nic): a failed save covers the bottom border until a snapshot makes it to disk
+    if (app->store != NULL && app->store->error[0] != '\0') {
+        char *message = arena_sprintf(&frame_arena, " Error: %s, retrying ", app->store->error);
+        screen_text(screen, 1, screen->h, message, strlen(message), screen->w, STYLE_SELECTED);
+    }
+}
 
-    fflush(stdout);
+void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--sync every-op|<N>ms|exit] [--escape-timeout <N>ms] [--stats] [--script SCRIPT] [FILE]\n", program);
+    fprintf(stderr, "       %s --bench %s[:N]\n", program, bench_workload_names);
+    fprintf(stderr, "    --sync             when the journal is flushed to disk (default: every-op)\n");
+    fprintf(stderr, "    --escape-timeout   how long ESC waits for the rest of a key sequence (default: %dms)\n", INPUT_ESCAPE_TIMEOUT_MS);
+    fprintf(stderr, "    --stats            count the memory of every part of the app and print it on exit\n");
+    fprintf(stderr, "    --script           type the keys in SCRIPT instead of reading the terminal and report the latency\n");
+    fprintf(stderr, "    --bench            run a built-in workload on an unsaved list and report the latency,\n");
+    fprintf(stderr, "                       WORKLOAD:N starts it with N entries, e.g. scroll:10000000\n");
+#ifdef PROFILE
+    fprintf(stderr, "    --trace TRACE      write the timed zones to TRACE on exit, for chrome://tracing\n");
+#endif
+    fprintf(stderr, "    FILE               where the lists are stored (default: %s)\n", STORE_DEFAULT_PATH);
 }
 
-int main(void) {
-#ifdef __linux__
-    signal(SIGINT, sigint_handler);
-#elif _WIN32
-    SetConsoleCtrlHandler(console_handler, TRUE);
+bool parse_ms(String_View sv, uint64_t *ms) {
+    if (sv.size <= 2 || sv.size - 2 >= 20 || memcmp(sv.data + sv.size - 2, "ms", 2) != 0) {
+        return false;
+    }
+    String_View digits = sv_from_parts(sv.data, sv.size - 2);
+    for (size_t i = 0; i < digits.size; ++i) {
+        if (digits.data[i] < '0' || digits.data[i] > '9') {
+            return false;
+        }
+    }
+    *ms = sv_to_uint64(digits);
+    return true;
+}
+
+bool parse_sync(const char *arg) {
+    String_View sv = SV(arg);
+    if (sv_eq(sv, SV("every-op"))) {
+        store.sync = STORE_SYNC_EVERY_OP;
+    } else if (sv_eq(sv, SV("exit"))) {
+        store.sync = STORE_SYNC_ON_EXIT;
+    } else if (parse_ms(sv, &store.sync_interval_ms)) {
+        store.sync = STORE_SYNC_INTERVAL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Shortest of two `wait_events()` timeouts where -1 means forever
+int min_timeout(int a, int b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return MIN(a, b);
+}
+
+// Counts every arena that lives as long as the app, with --stats only
+void track_memory(TODO_App *app) {
+    memory_track_app(app);
+    memory_track(&pool.arena, MEMORY_POOL);
+    memory_track(&app->search.pool.arena, MEMORY_SEARCH);
+    memory_track(&app->fuzzy.pool.arena, MEMORY_FUZZY);
+    memory_track(&app->layout.pool.arena, MEMORY_LAYOUT);
+    memory_track(&term_output.arena, MEMORY_OUTPUT);
+    memory_track(&store.arena, MEMORY_STORE);
+    memory_track(&bench.arena, MEMORY_SCRATCH);
+    memory_track(&profile.arena, MEMORY_SCRATCH);
+    memory_track(&frame_arena, MEMORY_SCRATCH);
+}
+
+// Types `script` into the app, drawing a frame after every event. Frames go to stdout
+// for --script and nowhere for --bench, at the fallback size either way.
+void run_headless(TODO_App *app, String_View script, uint64_t escape_timeout_ms) {
+    Screen screen = {0};
+    static Input input = {0};
+    if (print_stats) {
+        memory_track(&screen.arena, MEMORY_SCREEN);
+        memory_track(&input.arena, MEMORY_INPUT);
+    }
+    input.escape_timeout_ms = escape_timeout_ms;
+    screen_resize(&screen, TERM_FALLBACK_COLS, TERM_FALLBACK_ROWS);
+    Split split = split_rect((Rect) { 1, 1, TERM_FALLBACK_COLS, TERM_FALLBACK_ROWS });
+    draw_todo_app(&screen, app, split, 0.0f);
+    screen_flush(&screen);
+    term_flush();
+
+    bench_begin(&bench, &pool);
+    size_t fed = 0;
+    while (true) {
+        fed += input_feed(&input, script.data + fed, script.size - fed);
+        uint64_t start_ns = get_time_ns();
+        Input_Event event;
+        if (!input_next(&input, &event)) {
+            // NOTE(nic): a paste bigger than the ring empties it before its end marker
+            // is in, so only a dry ring after the last byte ends the run. An escape
+            // sequence cut off at the end of the script is still waiting for its
+            // rest then and never finished.
+            if (fed < script.size) {
+                continue;
+            }
+            break;
+        }
+        Arena_Mark frame_mark = scratch_begin(&frame_arena);
+        update_todo_app(&pool, app, &event);
+        if (app->state == TODO_STATE_FUZZY) {
+            fuzzy_poll(&app->fuzzy);
+        }
+        draw_todo_app(&screen, app, split, 0.0f);
+        screen_flush(&screen);
+        term_flush();
+        scratch_end(&frame_arena, frame_mark);
+        store_sync(&store, false);
+        store_maybe_compact(&store, app);
+        if (app->state != TODO_STATE_FUZZY && pool_should_compact(&pool, false)) {
+            app_compact(&pool, app);
+        }
+        bench_record(&bench, get_time_ns() - start_ns, term_output.frame_bytes);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *store_path = STORE_DEFAULT_PATH;
+    uint64_t escape_timeout_ms = INPUT_ESCAPE_TIMEOUT_MS;
+    const char *script_path = NULL;
+    const char *workload = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--sync") == 0 && i + 1 < argc) {
+            if (!parse_sync(argv[++i])) {
+                usage(argv[0]);
+                fprintf(stderr, "Error: unknown sync policy `%s`\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--escape-timeout") == 0 && i + 1 < argc) {
+            i += 1;
+            if (!parse_ms(SV(argv[i]), &escape_timeout_ms) || escape_timeout_ms > INT_MAX) {
+                usage(argv[0]);
+                fprintf(stderr, "Error: invalid escape timeout `%s`\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            print_stats = true;
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script_path = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            workload = argv[++i];
+#ifdef PROFILE
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+            profile.tracing = true;
+            profile.trace_start_ns = get_time_ns();
 #endif
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            fprintf(stderr, "Error: unknown flag `%s`\n", argv[i]);
+            return 1;
+        } else {
+            store_path = argv[i];
+        }
+    }
+
+    TODO_App app = {0};
+    if (print_stats) {
+        track_memory(&app);
+    }
+    if (workload != NULL) {
+        String script = {0};
+        // Nothing is saved, the app is built up in memory
+        store.journal_fd = -1;
+        uint64_t load_start_ns = get_time_ns();
+        if (!bench_workload(workload, &pool, &app, &bench.arena, &script)) {
+            usage(argv[0]);
+            fprintf(stderr, "Error: unknown workload or entry count `%s`\n", workload);
+            return 1;
+        }
+        bench.load_ns = get_time_ns() - load_start_ns;
+        headless = workload;
+        term_output.discard = true;
+        run_headless(&app, sv_from_parts(script.items, script.count), escape_timeout_ms);
+        handle_exit();
+    }
+    uint64_t load_start_ns = get_time_ns();
+    if (!store_open(&store, &pool, &app, store_path)) {
+        return 1;
+    }
+    bench.load_ns = get_time_ns() - load_start_ns;
+    if (script_path != NULL) {
+        String script = {0};
+        if (!read_script(script_path, &bench.arena, &script)) {
+            return 1;
+        }
+        headless = script_path;
+        run_headless(&app, sv_from_parts(script.items, script.count), escape_timeout_ms);
+        handle_exit();
+    }
+
     prepare_terminal();
+    prepare_events();
     invisible_cursor();
     create_page();
+    enable_bracketed_paste();
 
-    TODO_App app = {0};
-    Arena arena = {0};
+    Screen screen = {0};
+    static Input input = {0};
+    if (print_stats) {
+        memory_track(&screen.arena, MEMORY_SCREEN);
+        memory_track(&input.arena, MEMORY_INPUT);
+    }
+    input.escape_timeout_ms = escape_timeout_ms;
+
+    // NOTE(nic): the size only changes on EVENT_RESIZE, that is also the only time the
+    // screen and the split are laid out again. On windows every console input counts as
+    // a resize, so most of them find the size unchanged and do nothing.
+    Term_Size term_size = get_terminal_size();
+    screen_resize(&screen, term_size.cols, term_size.rows);
+    Split split = split_rect((Rect) { 1, 1, term_size.cols, term_size.rows });
+    size_t timer_ticks = 0;
+    int events = 0;
+    uint64_t last_input_ns = get_time_ns();
 
     while (true) {
-        Term_Size term_size = get_terminal_size();
-        Rect term_rect = { 1, 1, term_size.cols, term_size.rows };
-        Split split = split_rect(term_rect);
+        PROFILE_BEGIN(PROFILE_FRAME);
+        Arena_Mark frame_mark = scratch_begin(&frame_arena);
+        if (events & (EVENT_HANGUP | EVENT_QUIT)) {
+            handle_exit();
+        }
+        if (events & EVENT_RESIZE) {
+            Term_Size new_size = get_terminal_size();
+            if (new_size.rows != term_size.rows || new_size.cols != term_size.cols) {
+                term_size = new_size;
+                screen_resize(&screen, term_size.cols, term_size.rows);
+                split = split_rect((Rect) { 1, 1, term_size.cols, term_size.rows });
+            }
+        }
 
-        position_cursor(0, 0);
-        update_and_draw_todo_app(&arena, &app, split);
-#ifdef __linux__
-        usleep(1000000.0f*delta_time);
-#elif _WIN32
-        Sleep((DWORD)(1000.0f*delta_time));
+        // NOTE(nic): all pending input is handled before drawing once, so a burst of
+        // keys (or a paste without bracketed paste mode) costs a single frame
+        PROFILE_BEGIN(PROFILE_INPUT);
+        if (events & EVENT_INPUT) {
+            input_fill(&input);
+        }
+        Input_Event event;
+        bool has_event = input_next(&input, &event);
+        PROFILE_END(PROFILE_INPUT);
+        while (has_event) {
+            PROFILE_BEGIN(PROFILE_UPDATE);
+            update_todo_app(&pool, &app, &event);
+            last_input_ns = get_time_ns();
+            PROFILE_END(PROFILE_UPDATE);
+            PROFILE_BEGIN(PROFILE_INPUT);
+            has_event = input_next(&input, &event);
+            PROFILE_END(PROFILE_INPUT);
+        }
+        if (input.eof) {
+            handle_exit();
+        }
+
+        if (app.state == TODO_STATE_FUZZY) {
+            fuzzy_poll(&app.fuzzy);
+        }
+
+        // NOTE(nic): the animation only advances on timer ticks, keystrokes redraw without moving it
+        draw_todo_app(&screen, &app, split, timer_ticks*delta_time);
+#ifdef PROFILE
+        if (profile.overlay) {
+            profile_draw_overlay(&screen, term_size.rows);
+        }
 #endif
+        PROFILE_BEGIN(PROFILE_FLUSH);
+        screen_flush(&screen);
+        PROFILE_END(PROFILE_FLUSH);
+        PROFILE_BEGIN(PROFILE_WRITE);
+        term_flush();
+        PROFILE_END(PROFILE_WRITE);
+        scratch_end(&frame_arena, frame_mark);
+
+        store_sync(&store, false);
+        store_maybe_compact(&store, &app);
+
+        // NOTE(nic): a lot of waste is compacted right away, a little waits until
+        // the user stops typing so the pause never lands between two keystrokes.
+        // The workers of the fuzzy matcher read the entries, so they stay put until it is closed.
+        uint64_t idle_ms = (get_time_ns() - last_input_ns)/1000000;
+        int compact_timeout = -1;
+        bool can_compact = app.state != TODO_STATE_FUZZY;
+        if (can_compact && pool_should_compact(&pool, idle_ms >= POOL_IDLE_MS)) {
+            app_compact(&pool, &app);
+        } else if (can_compact && pool_should_compact(&pool, true)) {
+            compact_timeout = POOL_IDLE_MS - idle_ms;
+        }
+
+        if (app.animating) {
+            arm_timer(delta_time);
+        } else {
+            disarm_timer();
+        }
+        PROFILE_END(PROFILE_FRAME);
+#ifdef PROFILE
+        profile_frame_end();
+#endif
+        int timeout = min_timeout(store_sync_timeout(&store), input_timeout(&input));
+        if (app.state == TODO_STATE_FUZZY) {
+            timeout = min_timeout(timeout, fuzzy_timeout(&app.fuzzy));
+        }
+        events = wait_events(&timer_ticks, min_timeout(timeout, compact_timeout));
     }
     handle_exit();
     return 0;
@@ -0,0 +1,80 @@
+#include <stdint.h>
+
+#include "./memory.h"
+#include "./todo.h"
+
+Arena_Stats memory_stats[MEMORY_CATEGORY_COUNT] = {0};
+
+static TODO_App *memory_app = NULL;
+
+static const char *category_names[MEMORY_CATEGORY_COUNT] = {
+    [MEMORY_POOL]    = "pool",
+    [MEMORY_SEARCH]  = "search",
+    [MEMORY_FUZZY]   = "fuzzy",
+    [MEMORY_LAYOUT]  = "layout",
+    [MEMORY_SCREEN]  = "screen",
+    [MEMORY_OUTPUT]  = "output",
+    [MEMORY_INPUT]   = "input",
+    [MEMORY_STORE]   = "store",
+    [MEMORY_SCRATCH] = "scratch",
+};
+
+void memory_track(Arena *arena, Memory_Category category) {
+    arena->stats = &memory_stats[category];
+}
+
+void memory_track_app(TODO_App *app) {
+    memory_app = app;
+}
+
+Memory_Usage memory_usage(TODO_App *app) {
+    Memory_Usage usage = {0};
+    uintptr_t mapped_begin = (uintptr_t) app->mapped.data;
+    uintptr_t mapped_end = mapped_begin + app->mapped.size;
+    Entry_Table *table = &app->entries;
+    usage.entries = table->page_capacity*sizeof(*table->pages);
+    for (size_t page = 0; page < table->page_capacity; ++page) {
+        if (table->pages[page] == NULL) {
+            continue;
+        }
+        usage.entries += ENTRY_PAGE_SIZE*sizeof(Entry);
+        for (size_t i = 0; i < ENTRY_PAGE_SIZE && page*ENTRY_PAGE_SIZE + i < table->count; ++i) {
+            Entry *entry = &table->pages[page][i];
+            uintptr_t text = (uintptr_t) entry->text;
+            // Text in the mapped snapshot is not in the pool
+            if (!(entry->flags & ENTRY_FREE) && (text < mapped_begin || text >= mapped_end)) {
+                usage.text += entry->size;
+            }
+        }
+    }
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        List *list = &app->lists[i];
+        usage.lists += list->chunk_count*sizeof(List_Chunk);
+        if (list->chunk_capacity > 0) {
+            usage.lists += list->chunk_capacity*sizeof(*list->chunks) + (list->chunk_capacity + 1)*sizeof(*list->tree);
+        }
+    }
+    usage.line_edit = app->line_edit.capacity;
+    return usage;
+}
+
+void memory_print_stats(Pool *pool, FILE *stream) {
+    fprintf(stream, "memory: %-8s %12s %12s %12s %12s %10s %8s\n",
+            "", "regions", "peak", "requested", "realloc lost", "allocs", "oversize");
+    for (size_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+        Arena_Stats *stats = &memory_stats[i];
+        if (stats->allocs == 0) {
+            continue;
+        }
+        fprintf(stream, "memory: %-8s %12zu %12zu %12zu %12zu %10zu %8zu\n",
+                category_names[i], stats->region_bytes, stats->peak_region_bytes, stats->requested_bytes,
+                stats->realloc_wasted_bytes, stats->allocs, stats->oversized_allocs);
+    }
+    if (memory_app != NULL) {
+        Memory_Usage usage = memory_usage(memory_app);
+        size_t rounding = pool->used_bytes - pool->live_bytes;
+        fprintf(stream, "memory: pool holds %zu bytes of entry text, %zu of entries, %zu of lists, %zu of line edit, "
+                "%zu free and %zu rounding\n", usage.text, usage.entries, usage.lists, usage.line_edit,
+                pool->free_bytes, rounding);
+    }
+}
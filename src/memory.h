@@ -0,0 +1,48 @@
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "./arena.h"
+#include "./pool.h"
+
+// Defined in todo.h
+typedef struct TODO_App TODO_App;
+
+typedef enum {
+    // The pool of the app: entry text, the entry table, the lists and the line edit
+    MEMORY_POOL,
+    MEMORY_SEARCH,
+    MEMORY_FUZZY,
+    MEMORY_LAYOUT,
+    MEMORY_SCREEN,
+    MEMORY_OUTPUT,
+    MEMORY_INPUT,
+    MEMORY_STORE,
+    // Records of the benchmarks and the profiler, and the frame arena
+    MEMORY_SCRATCH,
+    MEMORY_CATEGORY_COUNT,
+} Memory_Category;
+
+// What the blocks of the pool of the app hold, in bytes asked for
+typedef struct {
+    size_t text;
+    size_t entries;
+    size_t lists;
+    size_t line_edit;
+} Memory_Usage;
+
+// NOTE(nic): Every arena of a category counts into the same Arena_Stats, an arena is
+// only counted from the moment it is tracked. The pool of the app serves everything of
+// the app from one arena, so how its bytes split up is found by walking the app
+// instead, which is only done when asked.
+extern Arena_Stats memory_stats[MEMORY_CATEGORY_COUNT];
+
+void memory_track(Arena *arena, Memory_Category category);
+// The app whose pool `memory_print_stats()` breaks down
+void memory_track_app(TODO_App *app);
+Memory_Usage memory_usage(TODO_App *app);
+void memory_print_stats(Pool *pool, FILE *stream);
+
+#endif // MEMORY_H_
@@ -2,6 +2,10 @@
 #define PLAT_H_
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "./arena.h"
 
 #ifdef __linux__
 #    include <unistd.h>
@@ -9,8 +13,13 @@
 #    include <termios.h>
 #    include <fcntl.h>
 #    include <sys/ioctl.h>
+#    include <sys/timerfd.h>
+#    include <poll.h>
+#    include <time.h>
+#    include <sys/resource.h>
 #elif _WIN32
 #    include <windows.h>
+#    include <psapi.h>
 #else
 #    error "OS not supported"
 #endif
@@ -27,7 +36,42 @@ typedef struct {
     size_t cols;
 } Term_Size;
 
+// Size assumed when stdout is not a terminal, like under a test harness or in a pipe
+#define TERM_FALLBACK_ROWS 24
+#define TERM_FALLBACK_COLS 80
+
+// NOTE(nic): Every escape sequence and glyph of a frame is appended here and written
+// out with a single `term_flush()`, instead of going through stdio for each of them
+typedef struct {
+    Arena arena;
+    char *items;
+    size_t count;
+    size_t capacity;
+    // Frames are only counted, not written, when nothing is there to show them
+    bool discard;
+
+    size_t frame_bytes;
+    size_t frame_syscalls;
+    size_t total_bytes;
+    size_t total_syscalls;
+} Term_Output;
+
+extern Term_Output term_output;
+
+// Numbers below this are formatted once and then copied into cursor movements
+#define TERM_NUMBER_CACHE_SIZE 1024
+
+typedef enum {
+    EVENT_INPUT  = 1 << 0,
+    EVENT_RESIZE = 1 << 1,
+    EVENT_TIMER  = 1 << 2,
+    EVENT_HANGUP = 1 << 3,
+    // SIGINT or Ctrl+C, the loop exits from there instead of the signal handler
+    EVENT_QUIT   = 1 << 4,
+} Event_Kind;
+
 // Terminal functions
+// Asks the terminal, call it on EVENT_RESIZE and keep the result
 Term_Size get_terminal_size(void);
 void prepare_terminal(void);
 void unprepare_terminal(void);
@@ -35,9 +79,34 @@ void visible_cursor(void);
 void invisible_cursor(void);
 void create_page(void);
 void delete_page(void);
+void enable_bracketed_paste(void);
+void disable_bracketed_paste(void);
 void set_bg_color(int bg, int fg);
 void reset_bg_color(void);
 void position_cursor(size_t s, size_t y);
+void move_cursor_right(size_t n);
+
+// Output functions
+void term_write(const char *data, size_t size);
+#define term_write_cstr(cstr) term_write((cstr), sizeof(cstr) - 1)
+void term_write_number(size_t n);
+void term_flush(void);
+
+// Event functions
+void prepare_events(void);
+void arm_timer(float interval);
+void disarm_timer(void);
+// Blocks until at least one event arrives or `timeout_ms` passes (-1 waits forever),
+// returns a mask of `Event_Kind`, 0 on timeout.
+// `timer_ticks` receives how many timer intervals elapsed since the last wait.
+int wait_events(size_t *timer_ticks, int timeout_ms);
+
+// Time functions
+uint64_t get_time_ns(void);
+// Processors the threads of the app can run on, 1 if unknown
+size_t get_cpu_count(void);
+// Most memory the process has had resident so far in bytes, 0 if unknown
+size_t get_peak_rss(void);
 
 #endif // PLAT_H_
 
@@ -45,11 +114,83 @@ void position_cursor(size_t s, size_t y);
 
 #ifdef __linux__
     struct termios tio = {0};
+    static int signal_pipe[2] = {-1, -1};
+    static int timer_fd = -1;
+    static bool timer_armed = false;
 #elif _WIN32
     HANDLE console;
     DWORD mode;
+    static HANDLE quit_event = NULL;
+    static DWORD timer_interval_ms = 0;
 #endif
 
+Term_Output term_output = {0};
+
+static struct {
+    char digits[TERM_NUMBER_CACHE_SIZE][4];
+    uint8_t sizes[TERM_NUMBER_CACHE_SIZE];
+    bool ready;
+} term_number_cache = {0};
+
+static void prepare_number_cache(void) {
+    for (size_t n = 0; n < TERM_NUMBER_CACHE_SIZE; ++n) {
+        term_number_cache.sizes[n] = snprintf(term_number_cache.digits[n], 4, "%zu", n);
+    }
+    term_number_cache.ready = true;
+}
+
+void term_write(const char *data, size_t size) {
+    arena_da_append_many(&term_output.arena, &term_output, data, size);
+}
+
+void term_write_number(size_t n) {
+    if (n < TERM_NUMBER_CACHE_SIZE) {
+        if (!term_number_cache.ready) {
+            prepare_number_cache();
+        }
+        term_write(term_number_cache.digits[n], term_number_cache.sizes[n]);
+    } else {
+        char buffer[32];
+        int size = snprintf(buffer, sizeof(buffer), "%zu", n);
+        term_write(buffer, size);
+    }
+}
+
+void term_flush(void) {
+    term_output.frame_bytes = term_output.count;
+    term_output.frame_syscalls = 0;
+    if (term_output.discard) {
+        term_output.total_bytes += term_output.frame_bytes;
+        term_output.count = 0;
+        return;
+    }
+#ifdef __linux__
+    size_t written = 0;
+    while (written < term_output.count) {
+        ssize_t n = write(STDOUT_FILENO, term_output.items + written, term_output.count - written);
+        term_output.frame_syscalls += 1;
+        if (n >= 0) {
+            written += n;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // NOTE(nic): stdout shares the file description with stdin on a tty, so it is O_NONBLOCK as well
+            struct pollfd pfd = { .fd = STDOUT_FILENO, .events = POLLOUT };
+            poll(&pfd, 1, -1);
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+#elif _WIN32
+    if (term_output.count > 0) {
+        DWORD written = 0;
+        WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), term_output.items, (DWORD) term_output.count, &written, NULL);
+        term_output.frame_syscalls += 1;
+    }
+#endif
+    term_output.total_bytes += term_output.frame_bytes;
+    term_output.total_syscalls += term_output.frame_syscalls;
+    term_output.count = 0;
+}
+
 void prepare_terminal(void) {
 #ifdef __linux__
     struct termios new_tio;
@@ -74,53 +215,255 @@ void unprepare_terminal(void) {
 }
 
 void visible_cursor(void) {
-    printf("\033[?25h");
+    term_write_cstr("\033[?25h");
 }
 
 void invisible_cursor(void) {
-    printf("\033[?25l");
+    term_write_cstr("\033[?25l");
 }
 
 void position_cursor(size_t x, size_t y) {
-    printf("\033[%zu;%zuH", y, x);
+    term_write_cstr("\033[");
+    term_write_number(y);
+    term_write_cstr(";");
+    term_write_number(x);
+    term_write_cstr("H");
+}
+
+void move_cursor_right(size_t n) {
+    term_write_cstr("\033[");
+    term_write_number(n);
+    term_write_cstr("C");
 }
 
 void create_page(void) {
-    printf("\033[?1049h");
+    term_write_cstr("\033[?1049h");
 }
 
 void delete_page(void) {
-    printf("\033[?1049l");
+    term_write_cstr("\033[?1049l");
+}
+
+void enable_bracketed_paste(void) {
+    term_write_cstr("\033[?2004h");
+}
+
+void disable_bracketed_paste(void) {
+    term_write_cstr("\033[?2004l");
 }
 
 void set_bg_color(int bg, int fg) {
-    printf("\033[%d;%dm", bg, fg);
+    term_write_cstr("\033[");
+    term_write_number(bg);
+    term_write_cstr(";");
+    term_write_number(fg);
+    term_write_cstr("m");
 }
 
 void reset_bg_color(void) {
-    printf("\033[0m");
+    term_write_cstr("\033[0m");
 }
 
 Term_Size get_terminal_size(void) {
-    Term_Size term_size = {0};
+    Term_Size term_size = { TERM_FALLBACK_ROWS, TERM_FALLBACK_COLS };
 #ifdef __linux__
+    // NOTE(nic): a pty nobody set the size of reports 0x0, which is no better than no terminal
     struct winsize w;
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) < 0) {
-        fprintf(stderr, "Error: could not get terminal size: %s\n", strerror(errno));
-        exit(1);
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_row > 0 && w.ws_col > 0) {
+        term_size.rows = w.ws_row;
+        term_size.cols = w.ws_col;
     }
-    term_size.rows = w.ws_row;
-    term_size.cols = w.ws_col;
 #elif _WIN32
     CONSOLE_SCREEN_BUFFER_INFO csbi;
-    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
-        fprintf(stderr, "Error: could not get terminal size\n");
-        exit(1);
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
+        term_size.cols = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+        term_size.rows = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
     }
-    term_size.cols = csbi.srWindow.Right - csbi.srWindow.Left + 1;
-    term_size.rows = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
 #endif
     return term_size;
 }
 
+// NOTE(nic): The handlers only write a byte saying which signal came into a pipe that
+// `wait_events()` polls, everything else happens in the loop. Nothing the app does on
+// a resize or on exit (the journal, the pool, stdio) is safe to run inside a handler.
+#ifdef __linux__
+static void signal_handler(int signum) {
+    int saved_errno = errno;
+    char byte = signum == SIGWINCH ? 'r' : 'q';
+    if (write(signal_pipe[1], &byte, 1) < 0) {
+        // NOTE(nic): pipe full means a wake up is already pending
+    }
+    errno = saved_errno;
+}
+#elif _WIN32
+static BOOL WINAPI console_handler(DWORD signal) {
+    if (signal == CTRL_C_EVENT) {
+        SetEvent(quit_event);
+        return TRUE;
+    }
+    return FALSE;
+}
+#endif
+
+void prepare_events(void) {
+#ifdef __linux__
+    if (pipe(signal_pipe) < 0) {
+        fprintf(stderr, "Error: could not create signal pipe: %s\n", strerror(errno));
+        exit(1);
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        fcntl(signal_pipe[i], F_SETFL, fcntl(signal_pipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(signal_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+    struct sigaction sa = {0};
+    sa.sa_handler = signal_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGWINCH, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        fprintf(stderr, "Error: could not create timer: %s\n", strerror(errno));
+        exit(1);
+    }
+#elif _WIN32
+    quit_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    SetConsoleCtrlHandler(console_handler, TRUE);
+#endif
+}
+
+void arm_timer(float interval) {
+#ifdef __linux__
+    if (timer_armed) {
+        return;
+    }
+    long nsec = (long) (interval*1000000000.0f);
+    struct itimerspec spec = {0};
+    spec.it_interval.tv_sec = nsec / 1000000000L;
+    spec.it_interval.tv_nsec = nsec % 1000000000L;
+    spec.it_value = spec.it_interval;
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+    timer_armed = true;
+#elif _WIN32
+    timer_interval_ms = (DWORD) (interval*1000.0f);
+#endif
+}
+
+void disarm_timer(void) {
+#ifdef __linux__
+    if (!timer_armed) {
+        return;
+    }
+    struct itimerspec spec = {0};
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+    timer_armed = false;
+#elif _WIN32
+    timer_interval_ms = 0;
+#endif
+}
+
+int wait_events(size_t *timer_ticks, int timeout_ms) {
+    int events = 0;
+    *timer_ticks = 0;
+#ifdef __linux__
+    struct pollfd fds[3] = {
+        { .fd = STDIN_FILENO,   .events = POLLIN },
+        { .fd = signal_pipe[0], .events = POLLIN },
+        { .fd = timer_fd,       .events = POLLIN },
+    };
+    nfds_t nfds = timer_armed ? 3 : 2;
+    while (poll(fds, nfds, timeout_ms) < 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "Error: could not wait for events: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+    if (fds[0].revents & POLLIN) {
+        events |= EVENT_INPUT;
+    } else if (fds[0].revents & (POLLHUP | POLLERR)) {
+        events |= EVENT_HANGUP;
+    }
+    if (fds[1].revents & POLLIN) {
+        char buffer[64];
+        ssize_t n;
+        while ((n = read(signal_pipe[0], buffer, sizeof(buffer))) > 0) {
+            for (ssize_t i = 0; i < n; ++i) {
+                events |= buffer[i] == 'r' ? EVENT_RESIZE : EVENT_QUIT;
+            }
+        }
+    }
+    if (nfds > 2 && (fds[2].revents & POLLIN)) {
+        uint64_t expirations = 0;
+        if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+            *timer_ticks = expirations;
+            events |= EVENT_TIMER;
+        }
+    }
+#elif _WIN32
+    DWORD timeout = timer_interval_ms > 0 ? timer_interval_ms : INFINITE;
+    if (timeout_ms >= 0 && (DWORD) timeout_ms < timeout) {
+        timeout = timeout_ms;
+    }
+    HANDLE handles[2] = { console, quit_event };
+    DWORD result = WaitForMultipleObjects(2, handles, FALSE, timeout);
+    if (result == WAIT_TIMEOUT) {
+        if (timer_interval_ms > 0) {
+            *timer_ticks = 1;
+            events |= EVENT_TIMER;
+        }
+    } else if (result == WAIT_OBJECT_0 + 1) {
+        events |= EVENT_QUIT;
+    } else {
+        // NOTE(nic): window buffer size changes arrive as console input records
+        events |= EVENT_INPUT | EVENT_RESIZE;
+    }
+#endif
+    return events;
+}
+
+uint64_t get_time_ns(void) {
+#ifdef __linux__
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#elif _WIN32
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) (counter.QuadPart / frequency.QuadPart)*1000000000ULL
+        + (uint64_t) (counter.QuadPart % frequency.QuadPart)*1000000000ULL / frequency.QuadPart;
+#endif
+}
+
+size_t get_cpu_count(void) {
+#ifdef __linux__
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t) count : 1;
+#elif _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#endif
+}
+
+size_t get_peak_rss(void) {
+#ifdef __linux__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) < 0) {
+        return 0;
+    }
+    return (size_t) usage.ru_maxrss*1024;
+#elif _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#endif
+}
+
 #endif // PLAT_IMPLEMENTATION
@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <string.h>
+
+#include "./pool.h"
+
+static size_t pool_class(size_t size) {
+    size_t class = 0;
+    while (((size_t) 1 << (class + POOL_MIN_SHIFT)) < size) {
+        class += 1;
+    }
+    assert(class < POOL_CLASS_COUNT);
+    return class;
+}
+
+static size_t pool_class_size(size_t class) {
+    return (size_t) 1 << (class + POOL_MIN_SHIFT);
+}
+
+void *pool_alloc(Pool *pool, size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+    size_t class = pool_class(size);
+    size_t class_size = pool_class_size(class);
+    void *ptr;
+    if (pool->free[class] != NULL) {
+        Pool_Block *block = pool->free[class];
+        pool->free[class] = block->next;
+        pool->free_bytes -= class_size;
+        pool->reuses += 1;
+        ptr = block;
+    } else {
+        ptr = arena_alloc(&pool->arena, class_size);
+    }
+    pool->allocs += 1;
+    pool->live_bytes += size;
+    pool->used_bytes += class_size;
+    return ptr;
+}
+
+void pool_free(Pool *pool, void *ptr, size_t size) {
+    if (ptr == NULL || size == 0) {
+        return;
+    }
+    size_t class = pool_class(size);
+    size_t class_size = pool_class_size(class);
+    Pool_Block *block = ptr;
+    block->next = pool->free[class];
+    pool->free[class] = block;
+    pool->free_bytes += class_size;
+    pool->live_bytes -= size;
+    pool->used_bytes -= class_size;
+}
+
+void *pool_realloc(Pool *pool, void *ptr, size_t old_size, size_t new_size) {
+    if (ptr != NULL && new_size > 0 && pool_class(old_size) == pool_class(new_size)) {
+        pool->live_bytes += new_size;
+        pool->live_bytes -= old_size;
+        return ptr;
+    }
+    void *new_ptr = pool_alloc(pool, new_size);
+    if (ptr != NULL && new_ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    }
+    pool_free(pool, ptr, old_size);
+    return new_ptr;
+}
+
+void *pool_memdup(Pool *pool, const void *data, size_t size) {
+    void *ptr = pool_alloc(pool, size);
+    if (ptr != NULL) {
+        memcpy(ptr, data, size);
+    }
+    return ptr;
+}
+
+size_t pool_arena_bytes(Pool *pool) {
+    size_t arena_bytes = 0;
+    for (Region *r = pool->arena.begin; r != NULL; r = r->next) {
+        arena_bytes += arena_region_bytes(r);
+    }
+    return arena_bytes;
+}
+
+bool pool_should_compact(Pool *pool, bool idle) {
+    size_t total = pool->used_bytes + pool->free_bytes;
+    if (total < POOL_COMPACT_MIN_SIZE) {
+        return false;
+    }
+    double ratio = idle ? POOL_IDLE_COMPACT_RATIO : POOL_COMPACT_RATIO;
+    return pool->free_bytes > total*ratio;
+}
+
+void pool_replace(Pool *pool, Pool *fresh, uint64_t pause_ns) {
+    size_t before = pool_arena_bytes(pool);
+    size_t after = pool_arena_bytes(fresh);
+    arena_free(&pool->arena);
+
+    fresh->allocs = pool->allocs;
+    fresh->reuses = pool->reuses;
+    fresh->compactions = pool->compactions + 1;
+    fresh->reclaimed_bytes = pool->reclaimed_bytes + (before > after ? before - after : 0);
+    fresh->compact_ns_total = pool->compact_ns_total + pause_ns;
+    fresh->compact_ns_max = pool->compact_ns_max > pause_ns ? pool->compact_ns_max : pause_ns;
+    *pool = *fresh;
+}
+
+void pool_print_stats(Pool *pool, FILE *stream) {
+    size_t arena_bytes = pool_arena_bytes(pool);
+    size_t rounding = pool->used_bytes - pool->live_bytes;
+    fprintf(stream, "pool: %zu live bytes, %zu wasted (%zu rounding, %zu free), %zu arena bytes\n",
+            pool->live_bytes, rounding + pool->free_bytes, rounding, pool->free_bytes, arena_bytes);
+    fprintf(stream, "pool: %zu allocations, %zu served from the free lists\n", pool->allocs, pool->reuses);
+    fprintf(stream, "pool: %zu compactions reclaimed %zu bytes, %.3fms longest pause, %.3fms in total\n",
+            pool->compactions, pool->reclaimed_bytes, pool->compact_ns_max/1e6, pool->compact_ns_total/1e6);
+}
@@ -0,0 +1,69 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "./arena.h"
+
+// Blocks come in power of two sizes from 1 << POOL_MIN_SHIFT up, the smallest class
+// has to fit the free list link
+#define POOL_MIN_SHIFT 4
+#define POOL_CLASS_COUNT 40
+
+// The owner of the pool copies everything live into a fresh pool once the free lists
+// hold more than POOL_COMPACT_RATIO of all the blocks, or POOL_IDLE_COMPACT_RATIO
+// after POOL_IDLE_MS without input. Small pools are never worth it.
+#define POOL_COMPACT_MIN_SIZE (256*1024)
+#define POOL_COMPACT_RATIO 0.5
+#define POOL_IDLE_COMPACT_RATIO 0.125
+#define POOL_IDLE_MS 1000
+
+typedef struct Pool_Block Pool_Block;
+
+struct Pool_Block {
+    Pool_Block *next;
+};
+
+// NOTE(nic): Size-classed free lists on top of an Arena. Every allocation is rounded
+// up to its class and freed blocks wait in the list of that class for the next
+// allocation of about the same size, so text churned by edits and deletes and arrays
+// abandoned by growth get reused instead of piling up in the arena.
+// Like `arena_realloc()` the caller passes the size a block was allocated with,
+// blocks carry no header.
+typedef struct {
+    Arena arena;
+    Pool_Block *free[POOL_CLASS_COUNT];
+
+    // Bytes asked for by the blocks in use
+    size_t live_bytes;
+    // Bytes of the blocks in use after rounding up to their class
+    size_t used_bytes;
+    // Bytes sitting in the free lists
+    size_t free_bytes;
+    size_t allocs;
+    size_t reuses;
+
+    size_t compactions;
+    size_t reclaimed_bytes;
+    uint64_t compact_ns_total;
+    uint64_t compact_ns_max;
+} Pool;
+
+void *pool_alloc(Pool *pool, size_t size);
+void pool_free(Pool *pool, void *ptr, size_t size);
+void *pool_realloc(Pool *pool, void *ptr, size_t old_size, size_t new_size);
+void *pool_memdup(Pool *pool, const void *data, size_t size);
+
+size_t pool_arena_bytes(Pool *pool);
+bool pool_should_compact(Pool *pool, bool idle);
+// Frees the regions of `pool` and moves `fresh` in its place, keeping the statistics.
+// Everything that was live in `pool` has to be copied into `fresh` by then.
+void pool_replace(Pool *pool, Pool *fresh, uint64_t pause_ns);
+
+// Live vs. wasted bytes, wasted being rounding within classes plus the free lists
+void pool_print_stats(Pool *pool, FILE *stream);
+
+#endif // POOL_H_
@@ -0,0 +1,100 @@
+#include <string.h>
+#include <errno.h>
+
+#include "./profile.h"
+#include "./utils.h"
+#include "./plat.h"
+#include "./scratch.h"
+
+Profile profile = {0};
+
+static const char *zone_names[PROFILE_ZONE_COUNT] = {
+    [PROFILE_FRAME]  = "frame",
+    [PROFILE_INPUT]  = "input",
+    [PROFILE_UPDATE] = "update",
+    [PROFILE_LISTS]  = "lists",
+    [PROFILE_BOXES]  = "boxes",
+    [PROFILE_FLUSH]  = "flush",
+    [PROFILE_WRITE]  = "write",
+};
+
+static size_t bucket_of(uint32_t us) {
+    size_t bucket = 0;
+    while (us > 1 && bucket + 1 < PROFILE_BUCKETS) {
+        us >>= 1;
+        bucket += 1;
+    }
+    return bucket;
+}
+
+void profile_record(Profile_Zone zone, uint64_t start_ns, uint64_t end_ns) {
+    profile.frame_ns[zone] += end_ns - start_ns;
+    if (profile.tracing && profile.count < PROFILE_TRACE_MAX) {
+        Profile_Span span = { start_ns, (uint32_t) MIN(end_ns - start_ns, UINT32_MAX), zone };
+        arena_da_append(&profile.arena, &profile, span);
+    }
+}
+
+void profile_frame_end(void) {
+    size_t slot = profile.frames % PROFILE_WINDOW;
+    for (size_t zone = 0; zone < PROFILE_ZONE_COUNT; ++zone) {
+        if (profile.frames >= PROFILE_WINDOW) {
+            profile.buckets[zone][bucket_of(profile.window_us[zone][slot])] -= 1;
+        }
+        uint32_t us = (uint32_t) MIN(profile.frame_ns[zone]/1000, UINT32_MAX);
+        profile.window_us[zone][slot] = us;
+        profile.buckets[zone][bucket_of(us)] += 1;
+        profile.frame_ns[zone] = 0;
+    }
+    profile.frames += 1;
+}
+
+size_t profile_quantile_us(Profile_Zone zone, double p) {
+    size_t count = MIN(profile.frames, PROFILE_WINDOW);
+    size_t target = (size_t) (p*count + 0.999);
+    size_t seen = 0;
+    for (size_t bucket = 0; bucket < PROFILE_BUCKETS; ++bucket) {
+        seen += profile.buckets[zone][bucket];
+        if (seen >= target) {
+            return (size_t) 1 << (bucket + 1);
+        }
+    }
+    return (size_t) 1 << PROFILE_BUCKETS;
+}
+
+void profile_draw_overlay(Screen *screen, size_t y) {
+    String row = {0};
+    str_append_cstr(&frame_arena, &row, " us p50/p99 <");
+    for (size_t zone = 0; zone < PROFILE_ZONE_COUNT; ++zone) {
+        str_append_fmt(&frame_arena, &row, " %s %zu/%zu", zone_names[zone],
+                       profile_quantile_us(zone, 0.5), profile_quantile_us(zone, 0.99));
+    }
+    for (size_t x = 1; x <= screen->w; ++x) {
+        screen_put(screen, x, y, ' ', STYLE_SELECTED);
+    }
+    screen_text(screen, 1, y, row.items, row.count, screen->w, STYLE_SELECTED);
+}
+
+bool profile_dump_trace(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Error: could not open trace `%s`: %s\n", path, strerror(errno));
+        return false;
+    }
+    // NOTE(nic): complete events ("ph":"X") carry their own duration, the viewers
+    // nest the zones by time
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < profile.count; ++i) {
+        Profile_Span *span = &profile.items[i];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}%s\n",
+                zone_names[span->zone], (span->start_ns - profile.trace_start_ns)/1000.0,
+                span->duration_ns/1000.0, i + 1 < profile.count ? "," : "");
+    }
+    fprintf(file, "]}\n");
+    bool ok = !ferror(file);
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "Error: could not write trace `%s`\n", path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "./arena.h"
+#include "./render.h"
+
+// Frames the histograms look back over
+#define PROFILE_WINDOW 256
+// Bucket i counts frames that spent [2^i, 2^(i+1)) microseconds in a zone, bucket 0 also takes everything below
+#define PROFILE_BUCKETS 24
+// Spans kept for the trace, the ones after are dropped
+#define PROFILE_TRACE_MAX (1024*1024)
+
+typedef enum {
+    PROFILE_FRAME,
+    PROFILE_INPUT,
+    PROFILE_UPDATE,
+    PROFILE_LISTS,
+    PROFILE_BOXES,
+    PROFILE_FLUSH,
+    PROFILE_WRITE,
+    PROFILE_ZONE_COUNT,
+} Profile_Zone;
+
+// NOTE(nic): The timers are only compiled in with -DPROFILE (`./build.sh profile`),
+// otherwise PROFILE_BEGIN and PROFILE_END are nothing and cost nothing. A zone can be
+// entered many times in a frame, the histograms get what it took in the whole frame.
+#ifdef PROFILE
+#    define PROFILE_BEGIN(zone) uint64_t profile_start_##zone = get_time_ns()
+#    define PROFILE_END(zone) profile_record((zone), profile_start_##zone, get_time_ns())
+#else
+#    define PROFILE_BEGIN(zone)
+#    define PROFILE_END(zone)
+#endif
+
+typedef struct {
+    uint64_t start_ns;
+    uint32_t duration_ns;
+    uint32_t zone;
+} Profile_Span;
+
+typedef struct {
+    // What each zone took in the current frame
+    uint64_t frame_ns[PROFILE_ZONE_COUNT];
+
+    // The last PROFILE_WINDOW frames and their histogram, per zone
+    uint32_t window_us[PROFILE_ZONE_COUNT][PROFILE_WINDOW];
+    uint32_t buckets[PROFILE_ZONE_COUNT][PROFILE_BUCKETS];
+    size_t frames;
+
+    bool overlay;
+    bool tracing;
+    uint64_t trace_start_ns;
+    Arena arena;
+    Profile_Span *items;
+    size_t count;
+    size_t capacity;
+} Profile;
+
+extern Profile profile;
+
+void profile_record(Profile_Zone zone, uint64_t start_ns, uint64_t end_ns);
+// Moves the times of the frame into the histograms
+void profile_frame_end(void);
+// Upper bound of the bucket the `p` quantile of the window falls into, in microseconds
+size_t profile_quantile_us(Profile_Zone zone, double p);
+// The p50 and p99 of every zone on one row, drawn over whatever is there
+void profile_draw_overlay(Screen *screen, size_t y);
+// Writes the spans in the Trace Event Format, for chrome://tracing or ui.perfetto.dev
+bool profile_dump_trace(const char *path);
+
+#endif // PROFILE_H_
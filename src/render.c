@@ -0,0 +1,215 @@
+#include <string.h>
+
+#include "./render.h"
+#include "./plat.h"
+#include "./unicode.h"
+
+#define CELL_INVALID ((Cell) { UINT32_MAX, { 0, 0 } })
+#define CELL_BLANK ((Cell) { ' ', { 0, 0 } })
+
+static bool cell_eq(Cell a, Cell b) {
+    return a.ch == b.ch && a.style.bg == b.style.bg && a.style.fg == b.style.fg;
+}
+
+static bool style_eq(Style a, Style b) {
+    return a.bg == b.bg && a.fg == b.fg;
+}
+
+// Cells that refer to a cluster in the table of the screen instead of a codepoint
+#define CELL_CLUSTER 0x80000000u
+
+static uint32_t cluster_hash(const char *text, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ (unsigned char) text[i])*16777619u;
+    }
+    return hash;
+}
+
+// Interns a cluster of more than one codepoint, falls back to its first codepoint
+// when it does not fit or the table is full for this frame
+static uint32_t screen_cluster(Screen *screen, const char *text, size_t size, uint32_t base) {
+    if (size > RENDER_CLUSTER_MAX_SIZE) {
+        return base;
+    }
+    size_t mask = 2*RENDER_CLUSTER_CAPACITY - 1;
+    size_t slot = cluster_hash(text, size) & mask;
+    while (screen->cluster_slots[slot] != 0) {
+        Render_Cluster *cluster = &screen->clusters[screen->cluster_slots[slot] - 1];
+        if (cluster->size == size && memcmp(cluster->bytes, text, size) == 0) {
+            return CELL_CLUSTER | (screen->cluster_slots[slot] - 1);
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (screen->cluster_count >= RENDER_CLUSTER_CAPACITY) {
+        return base;
+    }
+    Render_Cluster *cluster = &screen->clusters[screen->cluster_count];
+    memcpy(cluster->bytes, text, size);
+    cluster->size = size;
+    screen->cluster_count += 1;
+    screen->cluster_slots[slot] = screen->cluster_count;
+    return CELL_CLUSTER | (screen->cluster_count - 1);
+}
+
+void screen_resize(Screen *screen, size_t w, size_t h) {
+    arena_reset(&screen->arena);
+    screen->w = w;
+    screen->h = h;
+    screen->front = arena_alloc(&screen->arena, w*h*sizeof(Cell));
+    screen->back = arena_alloc(&screen->arena, w*h*sizeof(Cell));
+    screen->clusters = arena_alloc(&screen->arena, RENDER_CLUSTER_CAPACITY*sizeof(*screen->clusters));
+    screen->cluster_slots = arena_alloc(&screen->arena, 2*RENDER_CLUSTER_CAPACITY*sizeof(*screen->cluster_slots));
+    memset(screen->cluster_slots, 0, 2*RENDER_CLUSTER_CAPACITY*sizeof(*screen->cluster_slots));
+    screen->cluster_count = 0;
+    screen_invalidate(screen);
+    screen_clear(screen);
+}
+
+void screen_invalidate(Screen *screen) {
+    for (size_t i = 0; i < screen->w*screen->h; ++i) {
+        screen->front[i] = CELL_INVALID;
+    }
+    screen->invalid = true;
+}
+
+void screen_clear(Screen *screen) {
+    // NOTE(nic): the ids of clusters are only forgotten between frames, and the cells on
+    // the terminal that still use them have to be drawn again
+    if (screen->cluster_count >= RENDER_CLUSTER_CAPACITY*3/4) {
+        memset(screen->cluster_slots, 0, 2*RENDER_CLUSTER_CAPACITY*sizeof(*screen->cluster_slots));
+        screen->cluster_count = 0;
+        screen_invalidate(screen);
+    }
+    for (size_t i = 0; i < screen->w*screen->h; ++i) {
+        screen->back[i] = CELL_BLANK;
+    }
+}
+
+// Overwriting one half of a wide character blanks the other half
+static void screen_unlink(Screen *screen, Cell *row, size_t i) {
+    if (row[i].ch == CELL_TAIL && i > 0) {
+        row[i - 1].ch = ' ';
+    } else if (i + 1 < screen->w && row[i + 1].ch == CELL_TAIL) {
+        row[i + 1].ch = ' ';
+    }
+}
+
+static void screen_put_cell(Screen *screen, size_t x, size_t y, uint32_t ch, size_t width, Style style) {
+    if (x < 1 || y < 1 || x > screen->w || y > screen->h) {
+        return;
+    }
+    if (width == 2 && x == screen->w) {
+        ch = ' ';
+        width = 1;
+    }
+    Cell *row = &screen->back[(y - 1)*screen->w];
+    screen_unlink(screen, row, x - 1);
+    row[x - 1] = (Cell) { ch, style };
+    if (width == 2) {
+        screen_unlink(screen, row, x);
+        row[x] = (Cell) { CELL_TAIL, style };
+    }
+}
+
+void screen_put(Screen *screen, size_t x, size_t y, uint32_t ch, Style style) {
+    screen_put_cell(screen, x, y, ch, 1, style);
+}
+
+size_t screen_text(Screen *screen, size_t x, size_t y, const char *text, size_t size, size_t w, Style style) {
+    size_t col = 0;
+    size_t i = 0;
+    while (i < size && col < w) {
+        size_t width;
+        size_t n = grapheme_next(text + i, size - i, &width);
+        uint32_t ch;
+        size_t len = utf8_decode(text + i, n, &ch);
+        if (ch < 32 || (ch >= 127 && ch < 0xA0)) {
+            ch = '?';
+        } else if (len < n) {
+            ch = screen_cluster(screen, text + i, n, ch);
+        }
+        i += n;
+        if (width == 0) {
+            continue;
+        }
+        if (col + width > w) {
+            // NOTE(nic): half of a wide character does not exist, the column stays blank
+            screen_put_cell(screen, x + col, y, ' ', 1, style);
+            col += 1;
+            break;
+        }
+        screen_put_cell(screen, x + col, y, ch, width, style);
+        col += width;
+    }
+    return col;
+}
+
+static void emit_cell(Screen *screen, Cell cell, Style *current) {
+    if (cell.ch == CELL_TAIL) {
+        return;
+    }
+    if (!style_eq(cell.style, *current)) {
+        if (!style_eq(*current, STYLE_DEFAULT)) {
+            reset_bg_color();
+        }
+        if (cell.style.bg != 0 || cell.style.fg != 0) {
+            set_bg_color(cell.style.bg, cell.style.fg);
+        }
+        *current = cell.style;
+    }
+    if (cell.ch & CELL_CLUSTER) {
+        Render_Cluster *cluster = &screen->clusters[cell.ch & ~CELL_CLUSTER];
+        term_write(cluster->bytes, cluster->size);
+        return;
+    }
+    char buffer[4];
+    size_t len = utf8_encode(cell.ch, buffer);
+    term_write(buffer, len);
+}
+
+void screen_flush(Screen *screen) {
+    if (screen->invalid) {
+        reset_bg_color();
+        screen->invalid = false;
+    }
+
+    Style current = STYLE_DEFAULT;
+    for (size_t y = 0; y < screen->h; ++y) {
+        // NOTE(nic): SIZE_MAX means the terminal cursor is not on this row
+        size_t cursor = SIZE_MAX;
+        for (size_t x = 0; x < screen->w; ++x) {
+            size_t i = y*screen->w + x;
+            if (cell_eq(screen->back[i], screen->front[i])) {
+                continue;
+            }
+            if (cursor != x) {
+                bool bridge = cursor != SIZE_MAX && x > cursor && x - cursor <= RENDER_MAX_GAP;
+                for (size_t j = cursor; bridge && j < x; ++j) {
+                    bridge = style_eq(screen->back[y*screen->w + j].style, current);
+                }
+                if (bridge) {
+                    for (size_t j = cursor; j < x; ++j) {
+                        emit_cell(screen, screen->back[y*screen->w + j], &current);
+                    }
+                } else if (cursor != SIZE_MAX && x > cursor) {
+                    move_cursor_right(x - cursor);
+                } else {
+                    position_cursor(x + 1, y + 1);
+                }
+            }
+            emit_cell(screen, screen->back[i], &current);
+            screen->front[i] = screen->back[i];
+            cursor = x + 1;
+            // NOTE(nic): a wide character moves the terminal cursor over its tail as well
+            if (x + 1 < screen->w && screen->back[i + 1].ch == CELL_TAIL) {
+                screen->front[i + 1] = screen->back[i + 1];
+                cursor = x + 2;
+                x += 1;
+            }
+        }
+    }
+    if (!style_eq(current, STYLE_DEFAULT)) {
+        reset_bg_color();
+    }
+}
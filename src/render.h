@@ -0,0 +1,65 @@
+#ifndef RENDER_H_
+#define RENDER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "./arena.h"
+
+// NOTE(nic): Rewriting a few unchanged cells is cheaper than a cursor move
+// (`\033[yyy;xxxH`) when the gap between two damaged runs is this small
+#define RENDER_MAX_GAP 4
+
+typedef struct {
+    uint8_t bg;
+    uint8_t fg;
+} Style;
+
+#define STYLE_DEFAULT ((Style) { 0, 0 })
+#define STYLE_SELECTED ((Style) { 47, 30 })
+#define STYLE_DIM ((Style) { 0, 90 })
+
+// Clusters of more than one codepoint (emoji sequences, letters with combining marks)
+// are kept in a table of the screen and cells refer to them by index
+#define RENDER_CLUSTER_CAPACITY 1024
+#define RENDER_CLUSTER_MAX_SIZE 32
+
+typedef struct {
+    char bytes[RENDER_CLUSTER_MAX_SIZE];
+    uint8_t size;
+} Render_Cluster;
+
+// The second cell of a wide character
+#define CELL_TAIL (UINT32_MAX - 1)
+
+typedef struct {
+    uint32_t ch;
+    Style style;
+} Cell;
+
+typedef struct {
+    Arena arena;
+    size_t w;
+    size_t h;
+    Cell *front;
+    Cell *back;
+    bool invalid;
+
+    Render_Cluster *clusters;
+    uint16_t *cluster_slots;
+    size_t cluster_count;
+} Screen;
+
+// Coordinates are 1-based, same as `position_cursor()`.
+// Everything outside of the screen is clipped.
+// `screen_text()` goes by grapheme cluster and returns the columns it took, wide
+// characters take two and are never cut in half.
+void screen_resize(Screen *screen, size_t w, size_t h);
+void screen_invalidate(Screen *screen);
+void screen_clear(Screen *screen);
+void screen_put(Screen *screen, size_t x, size_t y, uint32_t ch, Style style);
+size_t screen_text(Screen *screen, size_t x, size_t y, const char *text, size_t size, size_t w, Style style);
+void screen_flush(Screen *screen);
+
+#endif // RENDER_H_
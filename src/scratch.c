@@ -0,0 +1,24 @@
+#include <string.h>
+
+#include "./scratch.h"
+
+Arena frame_arena = {0};
+
+Arena_Mark scratch_begin(Arena *arena) {
+    return arena_snapshot(arena);
+}
+
+void scratch_end(Arena *arena, Arena_Mark mark) {
+#ifndef NDEBUG
+    // A mark of an arena that had no regions yet rewinds all of them
+    Region *region = mark.region != NULL ? mark.region : arena->begin;
+    size_t from = mark.region != NULL ? mark.count : 0;
+    for (; region != NULL; region = region->next) {
+        if (region->count > from) {
+            memset(&region->data[from], SCRATCH_POISON, (region->count - from)*sizeof(*region->data));
+        }
+        from = 0;
+    }
+#endif
+    arena_rewind(arena, mark);
+}
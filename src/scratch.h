@@ -0,0 +1,22 @@
+#ifndef SCRATCH_H_
+#define SCRATCH_H_
+
+#include "./arena.h"
+
+// What a rewind gives back is filled with this in debug builds
+#define SCRATCH_POISON 0xDD
+
+// NOTE(nic): The frame arena holds what only lives until the frame is on the screen,
+// like the formatted status rows. The loop takes a mark before it handles the input
+// and rewinds to it once the frame is flushed, so every frame reuses the same regions
+// and the arena only ever grows to the biggest frame. A shorter scope inside the
+// frame does the same with its own mark. Without NDEBUG the rewound bytes are
+// poisoned, so a pointer kept past its scope reads garbage right away instead of
+// whatever the next frame put there.
+extern Arena frame_arena;
+
+Arena_Mark scratch_begin(Arena *arena);
+// `arena_rewind()` that poisons what it gives back in debug builds
+void scratch_end(Arena *arena, Arena_Mark mark);
+
+#endif // SCRATCH_H_
@@ -0,0 +1,263 @@
+#include <assert.h>
+#include <string.h>
+
+#include "./search.h"
+#include "./todo.h"
+
+#define SEARCH_INDEX_INIT_CAP 1024
+#define SEARCH_POSTING_INIT_CAP 4
+
+static uint32_t trigram(const char *s) {
+    return ((uint32_t) tolower((unsigned char) s[0]) << 16)
+        | ((uint32_t) tolower((unsigned char) s[1]) << 8)
+        | (uint32_t) tolower((unsigned char) s[2]);
+}
+
+static size_t index_slot(Search_Index *index, uint32_t key) {
+    size_t mask = index->capacity - 1;
+    uint32_t hash = key*0x9E3779B1u;
+    size_t i = (hash ^ (hash >> 15)) & mask;
+    while (index->keys[i] != 0 && index->keys[i] != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void index_grow(Pool *pool, Search_Index *index) {
+    Search_Index grown = *index;
+    grown.capacity = index->capacity == 0 ? SEARCH_INDEX_INIT_CAP : index->capacity*2;
+    grown.keys = pool_alloc(pool, grown.capacity*sizeof(*grown.keys));
+    grown.postings = pool_alloc(pool, grown.capacity*sizeof(*grown.postings));
+    memset(grown.keys, 0, grown.capacity*sizeof(*grown.keys));
+    for (size_t i = 0; i < index->capacity; ++i) {
+        if (index->keys[i] != 0) {
+            size_t slot = index_slot(&grown, index->keys[i]);
+            grown.keys[slot] = index->keys[i];
+            grown.postings[slot] = index->postings[i];
+        }
+    }
+    pool_free(pool, index->keys, index->capacity*sizeof(*index->keys));
+    pool_free(pool, index->postings, index->capacity*sizeof(*index->postings));
+    *index = grown;
+}
+
+static Search_Posting *index_posting(Search *search, uint32_t trigram, bool create) {
+    Search_Index *index = &search->index;
+    if (create && (index->count + 1)*2 > index->capacity) {
+        index_grow(&search->pool, index);
+    }
+    if (index->capacity == 0) {
+        return NULL;
+    }
+    uint32_t key = trigram + 1;
+    size_t slot = index_slot(index, key);
+    if (index->keys[slot] == 0) {
+        if (!create) {
+            return NULL;
+        }
+        index->keys[slot] = key;
+        index->postings[slot] = (Search_Posting) {0};
+        index->count += 1;
+    }
+    return &index->postings[slot];
+}
+
+void search_index_add(Search *search, uint32_t id, String_View text) {
+    if (!search->built) {
+        return;
+    }
+    for (size_t i = 0; i + 3 <= text.size; ++i) {
+        Search_Posting *posting = index_posting(search, trigram(text.data + i), true);
+        // NOTE(nic): nothing else is added in between, so a trigram that repeats
+        // within the text finds its id at the end already
+        if (posting->count > 0 && posting->items[posting->count - 1] == id) {
+            continue;
+        }
+        if (posting->count >= posting->capacity) {
+            uint32_t new_capacity = posting->capacity == 0 ? SEARCH_POSTING_INIT_CAP : posting->capacity*2;
+            posting->items = pool_realloc(&search->pool, posting->items,
+                                          posting->capacity*sizeof(*posting->items),
+                                          new_capacity*sizeof(*posting->items));
+            posting->capacity = new_capacity;
+        }
+        posting->items[posting->count++] = id;
+        search->index.total += 1;
+    }
+}
+
+void search_index_remove(Search *search, uint32_t id, String_View text) {
+    (void) id;
+    if (!search->built || text.size < 3) {
+        return;
+    }
+    search->index.stale = MIN(search->index.stale + text.size - 2, search->index.total);
+}
+
+static void search_build(Search *search, TODO_App *app) {
+    arena_free(&search->pool.arena);
+    Search fresh = {0};
+    fresh.pool.arena.stats = search->pool.arena.stats;
+    fresh.built = true;
+    *search = fresh;
+    for (size_t id = 0; id < app->entries.count; ++id) {
+        Entry *entry = app_entry(app, id);
+        if (!(entry->flags & ENTRY_FREE)) {
+            search_index_add(search, id, entry_text(entry));
+        }
+    }
+}
+
+static void search_push_result(Search *search, uint32_t id) {
+    if (search->count >= search->capacity) {
+        size_t new_capacity = search->capacity == 0 ? ARENA_DA_INIT_CAP : search->capacity*2;
+        search->results = pool_realloc(&search->pool, search->results,
+                                       search->capacity*sizeof(*search->results),
+                                       new_capacity*sizeof(*search->results));
+        search->capacity = new_capacity;
+    }
+    search->results[search->count++] = id;
+}
+
+static bool entry_matches(TODO_App *app, uint32_t id, String_View query) {
+    Entry *entry = app_entry(app, id);
+    return !(entry->flags & ENTRY_FREE) && sv_find_sv_nocase(entry_text(entry), query, NULL);
+}
+
+// Shortest posting among the trigrams of the query, NULL if one of them is not in
+// the index at all and nothing can match
+static Search_Posting *shortest_posting(Search *search, String_View query) {
+    Search_Posting *shortest = NULL;
+    for (size_t i = 0; i + 3 <= query.size; ++i) {
+        Search_Posting *posting = index_posting(search, trigram(query.data + i), false);
+        if (posting == NULL) {
+            return NULL;
+        }
+        if (shortest == NULL || posting->count < shortest->count) {
+            shortest = posting;
+        }
+    }
+    return shortest;
+}
+
+static void search_run(Search *search, TODO_App *app, String_View query) {
+    search->count = 0;
+    search->scanned = 0;
+    search->partial = false;
+    Search_Posting *posting = NULL;
+    if (query.size >= 3) {
+        posting = shortest_posting(search, query);
+        if (posting == NULL) {
+            return;
+        }
+    }
+    size_t entries = app->lists[TODO_LIST_TODOS].count + app->lists[TODO_LIST_DONES].count;
+    search->partial = posting == NULL || (size_t) posting->count*SEARCH_SCAN_RATIO > entries;
+    if (search->partial) {
+        return;
+    }
+    size_t words = (app->entries.count + 63)/64;
+    if (words > search->marks_capacity) {
+        pool_free(&search->pool, search->marks, search->marks_capacity*sizeof(*search->marks));
+        search->marks = pool_alloc(&search->pool, words*sizeof(*search->marks));
+        search->marks_capacity = words;
+    }
+    memset(search->marks, 0, words*sizeof(*search->marks));
+    // NOTE(nic): an edited entry is in the postings of its old and its new text, so an
+    // id is only counted the first time it is marked. Every entry that is not free is
+    // in one of the lists, so the walk below stops right after the last match.
+    size_t hits = 0;
+    for (uint32_t i = 0; i < posting->count; ++i) {
+        uint32_t id = posting->items[i];
+        uint64_t bit = (uint64_t) 1 << (id%64);
+        if (id < app->entries.count && !(search->marks[id/64] & bit) && entry_matches(app, id, query)) {
+            search->marks[id/64] |= bit;
+            hits += 1;
+        }
+    }
+
+    // NOTE(nic): the candidates come in the order they were indexed, walking the lists
+    // puts them back in list order
+    for (size_t i = 0; i < TODO_LIST_COUNT && hits > 0; ++i) {
+        List_Iter iter = list_iter_at(&app->lists[i], 0);
+        Entry_Id *id;
+        while (hits > 0 && list_iter_next(&iter, &id)) {
+            if (search->marks[*id/64] & ((uint64_t) 1 << (*id%64))) {
+                search_push_result(search, *id);
+                hits -= 1;
+            }
+        }
+    }
+}
+
+void search_update(Search *search, TODO_App *app, String_View query) {
+    Search_Index *index = &search->index;
+    if (!search->built || (index->stale > SEARCH_MIN_REBUILD && index->stale > index->total*SEARCH_MAX_STALE_RATIO)) {
+        search_build(search, app);
+    }
+
+    char *lowered = pool_alloc(&search->pool, query.size);
+    for (size_t i = 0; i < query.size; ++i) {
+        lowered[i] = tolower((unsigned char) query.data[i]);
+    }
+    String_View new_query = sv_from_parts(lowered, query.size);
+    String_View old_query = sv_from_parts(search->query, search->query_size);
+
+    // NOTE(nic): anything that contains the new query contains the old one too, so
+    // checking the previous results again is enough, unless the index has fewer candidates
+    bool narrow = search->valid && !search->partial && sv_find_sv_nocase(new_query, old_query, NULL);
+    if (narrow && new_query.size >= 3) {
+        Search_Posting *posting = shortest_posting(search, new_query);
+        narrow = posting != NULL && search->count <= posting->count;
+    }
+    if (narrow) {
+        size_t count = 0;
+        for (size_t i = 0; i < search->count; ++i) {
+            if (entry_matches(app, search->results[i], new_query)) {
+                search->results[count++] = search->results[i];
+            }
+        }
+        search->count = count;
+    } else {
+        search_run(search, app, new_query);
+    }
+
+    pool_free(&search->pool, search->query, search->query_size);
+    search->query = lowered;
+    search->query_size = query.size;
+    search->valid = true;
+    search->cursor = MIN(search->cursor, search->count > 0 ? search->count - 1 : 0);
+}
+
+void search_fill(Search *search, TODO_App *app, size_t count) {
+    if (!search->partial) {
+        return;
+    }
+    String_View query = sv_from_parts(search->query, search->query_size);
+    size_t start = 0;
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        List *list = &app->lists[i];
+        if (search->scanned < start + list->count) {
+            List_Iter iter = list_iter_at(list, search->scanned - start);
+            Entry_Id *id;
+            while (search->count < count && list_iter_next(&iter, &id)) {
+                search->scanned += 1;
+                if (entry_matches(app, *id, query)) {
+                    search_push_result(search, *id);
+                }
+            }
+            if (search->count >= count) {
+                return;
+            }
+        }
+        start += list->count;
+    }
+    search->partial = false;
+}
+
+void search_reset(Search *search) {
+    search->valid = false;
+    search->partial = false;
+    search->count = 0;
+    search->cursor = 0;
+    search->offset = 0;
+}
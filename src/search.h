@@ -0,0 +1,88 @@
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "./utils.h"
+#include "./pool.h"
+
+// Defined in todo.h
+typedef struct TODO_App TODO_App;
+
+// The index is rebuilt from scratch once more than this share of its postings
+// point to text that was deleted or edited since
+#define SEARCH_MAX_STALE_RATIO 0.5
+#define SEARCH_MIN_REBUILD 4096
+// A query whose rarest trigram is in more than 1/SEARCH_SCAN_RATIO of the entries
+// probably matches about as much, so the lists are scanned instead of the posting
+#define SEARCH_SCAN_RATIO 16
+
+typedef struct {
+    uint32_t *items;
+    uint32_t count;
+    uint32_t capacity;
+} Search_Posting;
+
+// NOTE(nic): Trigram index over the (ASCII lowercased) text of every entry, a posting
+// holds the ids of the entries that contain the trigram. A query of three bytes or more
+// only looks at the entries in the shortest posting of its trigrams.
+// Deleting and editing entries does not go through the postings, the old ids just turn
+// stale. Every candidate is checked against its text anyway, so a stale id costs a
+// comparison until the next rebuild.
+typedef struct {
+    // Open addressing, a key is the trigram plus one so 0 marks an empty slot
+    uint32_t *keys;
+    Search_Posting *postings;
+    size_t capacity;
+    size_t count;
+    size_t total;
+    size_t stale;
+} Search_Index;
+
+typedef struct {
+    // Everything of the search lives here and is freed at once on a rebuild
+    Pool pool;
+    // Built the first time a search starts, so startup never touches the text of
+    // entries that are not displayed
+    bool built;
+    Search_Index index;
+
+    // Lowercased query the results are for
+    char *query;
+    size_t query_size;
+    bool valid;
+
+    // NOTE(nic): A query shorter than a trigram has no candidates to narrow the list down
+    // to, and a query made of common trigrams has about as many candidates as the list
+    // has entries, like the empty query `/` starts with that matches every entry. Their
+    // results are only scanned up to what `search_fill()` is asked for, which is what
+    // is on the screen, and `scanned` is where the scan picks up again, counting the
+    // done list as if it came right after the todo list.
+    bool partial;
+    size_t scanned;
+
+    // Ids of the matching entries of both lists, the todo list first and each in
+    // list order
+    uint32_t *results;
+    size_t count;
+    size_t capacity;
+    size_t cursor;
+    size_t offset;
+
+    // One bit per entry id, marks the candidates that passed the check
+    uint64_t *marks;
+    size_t marks_capacity;
+} Search;
+
+void search_index_add(Search *search, uint32_t id, String_View text);
+void search_index_remove(Search *search, uint32_t id, String_View text);
+// Runs `query` against both lists, narrowing the previous results down if `query`
+// contains the previous query
+void search_update(Search *search, TODO_App *app, String_View query);
+void search_reset(Search *search);
+// Scans until there are `count` results, or all of them if there are fewer
+void search_fill(Search *search, TODO_App *app, size_t count);
+
+#endif // SEARCH_H_
@@ -0,0 +1,687 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#    include <unistd.h>
+#    include <libgen.h>
+#    include <sys/wait.h>
+#    include <sys/mman.h>
+#elif _WIN32
+#    include <windows.h>
+#    include <io.h>
+#    define ftruncate _chsize
+#else
+#    error "OS not supported"
+#endif
+
+#ifndef O_BINARY
+#    define O_BINARY 0
+#endif
+
+#include "./store.h"
+#include "./plat.h"
+#include "./scratch.h"
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t generation;
+    uint32_t counts[TODO_LIST_COUNT];
+} Store_Header;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t generation;
+} Journal_Header;
+
+typedef struct {
+    uint32_t checksum;
+    uint8_t op;
+    uint8_t list_index;
+    uint16_t reserved;
+    uint32_t entry_index;
+    uint32_t size;
+    int64_t time;
+} Journal_Record;
+
+static uint32_t fnv1a(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t record_checksum(Journal_Record *record, const char *text) {
+    uint32_t hash = 2166136261u;
+    hash = fnv1a(hash, (const char *) record + sizeof(record->checksum), sizeof(*record) - sizeof(record->checksum));
+    return fnv1a(hash, text, record->size);
+}
+
+static uint64_t now_ms(void) {
+    return get_time_ns() / 1000000;
+}
+
+static bool read_entire_file(Arena *arena, const char *path, String_View *contents, bool *missing) {
+    *missing = false;
+#ifdef __linux__
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *missing = errno == ENOENT;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    char *data = arena_alloc(arena, st.st_size);
+    size_t size = 0;
+    while (size < (size_t) st.st_size) {
+        ssize_t n = read(fd, data + size, st.st_size - size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            close(fd);
+            return false;
+        }
+        size += n;
+    }
+    close(fd);
+#elif _WIN32
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        *missing = errno == ENOENT;
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = arena_alloc(arena, file_size);
+    size_t size = fread(data, 1, file_size, file);
+    fclose(file);
+    if (size != (size_t) file_size) {
+        return false;
+    }
+#endif
+    *contents = sv_from_parts(data, size);
+    return true;
+}
+
+static bool write_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+#ifdef __linux__
+        ssize_t n = write(fd, data, size);
+#elif _WIN32
+        int n = _write(fd, data, (unsigned int) size);
+#endif
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool sync_file(int fd) {
+#ifdef __linux__
+    return fdatasync(fd) == 0;
+#elif _WIN32
+    return _commit(fd) == 0;
+#endif
+}
+
+static void sync_parent_dir(const char *path) {
+#ifdef __linux__
+    // NOTE(nic): a rename or a new file is only durable once the directory is synced
+    char *dir_path = strdup(path);
+    int dir_fd = open(dirname(dir_path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    free(dir_path);
+#elif _WIN32
+    (void) path;
+#endif
+}
+
+static bool replace_file(const char *from, const char *to) {
+#ifdef __linux__
+    return rename(from, to) == 0;
+#elif _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#endif
+}
+
+// NOTE(nic): The snapshot is mapped and every entry is a view straight into it.
+// Startup only reads the header, the lists start out as ranges of ids and a page of
+// entries is filled from the offset table the first time one of its ids is used, so
+// only the visible window is touched. Edits copy into the pool, the mapping itself is read-only.
+static bool map_entire_file(Arena *arena, const char *path, String_View *contents, bool *missing) {
+#ifdef __linux__
+    (void) arena;
+    *missing = false;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *missing = errno == ENOENT;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        *contents = sv_from_parts(NULL, 0);
+        return true;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    *contents = sv_from_parts(data, st.st_size);
+    return true;
+#elif _WIN32
+    return read_entire_file(arena, path, contents, missing);
+#endif
+}
+
+static bool load_snapshot(Arena *arena, Pool *pool, TODO_App *app, const char *path, uint64_t *generation, String_View *contents) {
+    bool missing = false;
+    *generation = 0;
+    *contents = sv_from_parts(NULL, 0);
+    if (!map_entire_file(arena, path, contents, &missing)) {
+        if (missing) {
+            return true;
+        }
+        fprintf(stderr, "Error: could not read %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    Store_Header header;
+    if (contents->size < sizeof(header)) {
+        fprintf(stderr, "Error: %s is truncated\n", path);
+        return false;
+    }
+    memcpy(&header, contents->data, sizeof(header));
+    if (memcmp(header.magic, STORE_MAGIC, sizeof(header.magic)) != 0 || header.version != STORE_VERSION) {
+        fprintf(stderr, "Error: %s is not a todo-tui v%d file\n", path, STORE_VERSION);
+        return false;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        total += header.counts[i];
+    }
+    size_t table_size = (total + 1)*sizeof(uint64_t) + total*2*sizeof(int64_t);
+    if (contents->size - sizeof(header) < table_size) {
+        fprintf(stderr, "Error: %s is truncated\n", path);
+        return false;
+    }
+    const uint64_t *offsets = (const uint64_t *) (contents->data + sizeof(header));
+    const int64_t *times = (const int64_t *) (offsets + total + 1);
+    const char *blob = contents->data + sizeof(header) + table_size;
+    size_t blob_size = contents->size - sizeof(header) - table_size;
+
+    if (total >= UINT32_MAX || offsets[0] > offsets[total] || offsets[total] > blob_size) {
+        fprintf(stderr, "Error: %s is corrupted\n", path);
+        return false;
+    }
+    app_load_snapshot(pool, app, (Entry_Snapshot) {
+        .offsets = offsets,
+        .times = times,
+        .text = blob,
+        .text_size = blob_size,
+        .count = total,
+        .dones = header.counts[TODO_LIST_TODOS],
+    });
+    *generation = header.generation;
+    app->mapped = *contents;
+    return true;
+}
+
+static bool replay_record(Pool *pool, TODO_App *app, Journal_Record *record, const char *text) {
+    if (record->list_index >= TODO_LIST_COUNT) {
+        return false;
+    }
+    List *list = &app->lists[record->list_index];
+    switch ((Store_Op) record->op) {
+    case STORE_OP_ADD: {
+        if (record->entry_index != list->count) {
+            return false;
+        }
+        app_add_entry(pool, app, record->list_index, text, record->size, record->time);
+    } break;
+    case STORE_OP_DELETE: {
+        if (record->entry_index >= list->count) {
+            return false;
+        }
+        app_delete_entry(pool, app, record->list_index, record->entry_index);
+    } break;
+    case STORE_OP_MOVE: {
+        if (record->entry_index >= list->count) {
+            return false;
+        }
+        app_move_entry(pool, app, record->list_index, record->entry_index, record->time);
+    } break;
+    case STORE_OP_EDIT: {
+        if (record->entry_index >= list->count) {
+            return false;
+        }
+        app_edit_entry(pool, app, record->list_index, record->entry_index, text, record->size);
+    } break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// Replays the journal at `path` if it applies on top of `generation`.
+// `valid_size` receives the size of the intact prefix, a torn record at the end
+// (crash in the middle of an append) is where the replay stops.
+static bool replay_journal(Arena *journal_arena, Pool *pool, TODO_App *app, const char *path, uint64_t generation, size_t *valid_size) {
+    String_View contents = {0};
+    bool missing = false;
+    *valid_size = 0;
+    if (!read_entire_file(journal_arena, path, &contents, &missing)) {
+        return false;
+    }
+
+    Journal_Header header;
+    if (contents.size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, contents.data, sizeof(header));
+    if (memcmp(header.magic, STORE_JOURNAL_MAGIC, sizeof(header.magic)) != 0
+        || header.version != STORE_VERSION
+        || header.generation != generation) {
+        return false;
+    }
+
+    size_t offset = sizeof(header);
+    while (contents.size - offset >= sizeof(Journal_Record)) {
+        Journal_Record record;
+        memcpy(&record, contents.data + offset, sizeof(record));
+        const char *text = contents.data + offset + sizeof(record);
+        if (contents.size - offset - sizeof(record) < record.size) {
+            break;
+        }
+        if (record_checksum(&record, text) != record.checksum) {
+            break;
+        }
+        if (!replay_record(pool, app, &record, text)) {
+            fprintf(stderr, "Warning: %s: record at offset %zu does not apply, ignoring the rest\n", path, offset);
+            break;
+        }
+        offset += sizeof(record) + record.size;
+    }
+    *valid_size = offset;
+    return true;
+}
+
+static bool create_journal(Store *store) {
+    int fd = open(store->journal_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_BINARY, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    Journal_Header header = {0};
+    memcpy(header.magic, STORE_JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.generation = store->generation;
+    if (!write_all(fd, (const char *) &header, sizeof(header)) || !sync_file(fd)) {
+        close(fd);
+        return false;
+    }
+    sync_parent_dir(store->journal_path);
+    store->journal_fd = fd;
+    store->journal_size = sizeof(header);
+    store->unsynced = false;
+    return true;
+}
+
+static void store_fail(Store *store, const char *what, const char *path) {
+    snprintf(store->error, sizeof(store->error), "%s %s: %s", what, path, strerror(errno));
+}
+
+static size_t snapshot_size(TODO_App *app) {
+    size_t count = 0;
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        count += app->lists[i].count;
+    }
+    return sizeof(Store_Header) + sizeof(uint64_t) + count*(sizeof(uint64_t) + 2*sizeof(int64_t)) + app->entries.text_bytes;
+}
+
+bool store_open(Store *store, Pool *pool, TODO_App *app, const char *path) {
+    store->path = path;
+    store->journal_path = arena_sprintf(&store->arena, "%s.journal", path);
+    store->old_journal_path = arena_sprintf(&store->arena, "%s.journal.old", path);
+    store->journal_fd = -1;
+
+    uint64_t generation;
+    if (!load_snapshot(&store->arena, pool, app, path, &generation, &store->snapshot)) {
+        return false;
+    }
+    store->snapshot_size = store->snapshot.size;
+
+    // NOTE(nic): An old journal is left behind when a compaction did not finish.
+    // If the snapshot predates it, it goes first and the current journal follows it.
+    // Replayed entries are copied into `pool`, the journal contents themselves are not kept
+    Arena journal_arena = {0};
+    size_t valid_size = 0;
+    bool replayed_old = replay_journal(&journal_arena, pool, app, store->old_journal_path, generation, &valid_size);
+    uint64_t journal_generation = replayed_old ? generation + 1 : generation;
+    bool replayed = replay_journal(&journal_arena, pool, app, store->journal_path, journal_generation, &valid_size);
+    arena_free(&journal_arena);
+
+    if (replayed_old) {
+        store->generation = journal_generation + 1;
+        if (!store_save(app, path, store->generation)) {
+            fprintf(stderr, "Error: could not write %s: %s\n", path, strerror(errno));
+            return false;
+        }
+        store->snapshot_size = snapshot_size(app);
+        replayed = false;
+    } else {
+        store->generation = generation;
+    }
+    remove(store->old_journal_path);
+
+    if (replayed) {
+        store->journal_fd = open(store->journal_path, O_WRONLY | O_APPEND | O_BINARY);
+        if (store->journal_fd >= 0 && ftruncate(store->journal_fd, valid_size) < 0) {
+            close(store->journal_fd);
+            store->journal_fd = -1;
+        }
+        store->journal_size = valid_size;
+    }
+    if (store->journal_fd < 0 && !create_journal(store)) {
+        fprintf(stderr, "Error: could not create %s: %s\n", store->journal_path, strerror(errno));
+        return false;
+    }
+
+    app->store = store;
+    store->app = app;
+    return true;
+}
+
+// Writes the lists into a snapshot of the next generation and starts a journal for it,
+// which covers whatever the journal and the old journal were missing
+static bool store_resave(Store *store, TODO_App *app) {
+    store->retry_deadline_ms = now_ms() + STORE_RETRY_MS;
+    if (store->journal_fd >= 0) {
+        close(store->journal_fd);
+        store->journal_fd = -1;
+    }
+    uint64_t generation = store->generation + 1;
+    if (!store_save(app, store->path, generation)) {
+        store_fail(store, "could not write", store->path);
+        return false;
+    }
+    store->generation = generation;
+    store->snapshot_size = snapshot_size(app);
+    remove(store->old_journal_path);
+    if (!create_journal(store)) {
+        // NOTE(nic): the snapshot has everything so far, only what comes after it is
+        // not journaled, so the next try is another snapshot
+        store_fail(store, "could not create", store->journal_path);
+        return false;
+    }
+    store->resave = false;
+    store->error[0] = '\0';
+    return true;
+}
+
+void store_close(Store *store) {
+    // NOTE(nic): a failed sync asks for a snapshot too, so it goes first
+    store_sync(store, true);
+    if (store->resave && store->compactor == 0 && store->app != NULL) {
+        store_resave(store, store->app);
+    }
+    if (store->journal_fd < 0) {
+        return;
+    }
+    store_sync(store, true);
+    close(store->journal_fd);
+    store->journal_fd = -1;
+}
+
+void store_log(Store *store, Store_Op op, TODO_List_Index list_index, size_t entry_index, const char *text, size_t size, int64_t time) {
+    // NOTE(nic): Records point at entries by position, so once one of them is lost the
+    // ones after it would be replayed onto the wrong entries. Until the next snapshot
+    // has everything the journal stays as it is.
+    if (store->journal_fd < 0 || store->resave) {
+        return;
+    }
+    Journal_Record record = {0};
+    record.op = op;
+    record.list_index = list_index;
+    record.entry_index = entry_index;
+    record.size = size;
+    record.time = time;
+    record.checksum = record_checksum(&record, text);
+
+    // NOTE(nic): one write per record, so a crash can only tear the last one
+    Arena_Mark mark = scratch_begin(&store->arena);
+    String buffer = {0};
+    str_append_sized(&store->arena, &buffer, (const char *) &record, sizeof(record));
+    str_append_sized(&store->arena, &buffer, text, size);
+    bool written = write_all(store->journal_fd, buffer.items, buffer.count);
+    scratch_end(&store->arena, mark);
+    if (!written) {
+        // NOTE(nic): the replay stops at a torn record and would drop every record
+        // appended after it, so the journal is cut back to where this one started.
+        // The change itself gets into the snapshot the next compaction writes.
+        store_fail(store, "could not write", store->journal_path);
+        store->resave = true;
+        if (ftruncate(store->journal_fd, store->journal_size) < 0) {
+            close(store->journal_fd);
+            store->journal_fd = -1;
+        }
+        return;
+    }
+    store->journal_size += buffer.count;
+
+    switch (store->sync) {
+    case STORE_SYNC_EVERY_OP: {
+        if (!sync_file(store->journal_fd)) {
+            store_fail(store, "could not sync", store->journal_path);
+            store->resave = true;
+        }
+    } break;
+    case STORE_SYNC_INTERVAL: {
+        if (!store->unsynced) {
+            store->sync_deadline_ms = now_ms() + store->sync_interval_ms;
+        }
+        store->unsynced = true;
+    } break;
+    case STORE_SYNC_ON_EXIT: {
+        store->unsynced = true;
+    } break;
+    }
+}
+
+void store_sync(Store *store, bool force) {
+    if (!store->unsynced || store->journal_fd < 0) {
+        return;
+    }
+    bool due = store->sync == STORE_SYNC_INTERVAL && now_ms() >= store->sync_deadline_ms;
+    if (force || due) {
+        if (!sync_file(store->journal_fd)) {
+            store_fail(store, "could not sync", store->journal_path);
+            store->resave = true;
+        }
+        store->unsynced = false;
+    }
+}
+
+int store_sync_timeout(Store *store) {
+    if (!store->unsynced || store->sync != STORE_SYNC_INTERVAL) {
+        return -1;
+    }
+    uint64_t now = now_ms();
+    if (now >= store->sync_deadline_ms) {
+        return 0;
+    }
+    return (int) (store->sync_deadline_ms - now);
+}
+
+static void reap_compactor(Store *store) {
+#ifdef __linux__
+    int status = 0;
+    if (store->compactor > 0 && waitpid(store->compactor, &status, WNOHANG) != 0) {
+        store->compactor = 0;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            // The old journal is still needed, the next compaction must not replace it
+            snprintf(store->error, sizeof(store->error), "could not write %s in the background", store->path);
+            store->resave = true;
+        }
+    }
+#elif _WIN32
+    (void) store;
+#endif
+}
+
+void store_maybe_compact(Store *store, TODO_App *app) {
+    reap_compactor(store);
+    if (store->compactor > 0) {
+        return;
+    }
+    if (store->resave) {
+        if (now_ms() >= store->retry_deadline_ms) {
+            store_resave(store, app);
+        }
+        return;
+    }
+    if (store->journal_fd < 0) {
+        return;
+    }
+    if (store->journal_size < STORE_COMPACT_MIN_SIZE) {
+        return;
+    }
+    if (store->journal_size < store->snapshot_size*STORE_COMPACT_RATIO) {
+        return;
+    }
+
+    // NOTE(nic): The current journal is set aside and a new one for the next generation
+    // is started right away, so appends never wait for the snapshot to be written.
+    store_sync(store, true);
+    if (store->resave) {
+        store_resave(store, app);
+        return;
+    }
+    close(store->journal_fd);
+    store->journal_fd = -1;
+    if (!replace_file(store->journal_path, store->old_journal_path)) {
+        store->journal_fd = open(store->journal_path, O_WRONLY | O_APPEND | O_BINARY);
+        if (store->journal_fd < 0) {
+            store_fail(store, "could not reopen", store->journal_path);
+            store->resave = true;
+            store_resave(store, app);
+        }
+        return;
+    }
+    store->generation += 1;
+    if (!create_journal(store)) {
+        // Nothing journals the next generation, so it goes straight into a snapshot
+        store_fail(store, "could not create", store->journal_path);
+        store->resave = true;
+        store_resave(store, app);
+        return;
+    }
+    store->snapshot_size = snapshot_size(app);
+
+#ifdef __linux__
+    // NOTE(nic): The child gets a copy-on-write image of the lists as of now and
+    // writes the snapshot from it while the parent keeps going.
+    int pid = fork();
+    if (pid == 0) {
+        bool ok = store_save(app, store->path, store->generation);
+        if (ok) {
+            unlink(store->old_journal_path);
+        }
+        _exit(ok ? 0 : 1);
+    } else if (pid > 0) {
+        store->compactor = pid;
+        return;
+    }
+#endif
+    if (store_save(app, store->path, store->generation)) {
+        remove(store->old_journal_path);
+    } else {
+        store_fail(store, "could not write", store->path);
+        store->resave = true;
+    }
+}
+
+bool store_save(TODO_App *app, const char *path, uint64_t generation) {
+    Arena arena = {0};
+    String image = {0};
+
+    Store_Header header = {0};
+    memcpy(header.magic, STORE_MAGIC, sizeof(header.magic));
+    header.version = STORE_VERSION;
+    header.generation = generation;
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        header.counts[i] = app->lists[i].count;
+    }
+    str_append_sized(&arena, &image, (const char *) &header, sizeof(header));
+
+    uint64_t offset = 0;
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        List_Iter iter = list_iter_at(&app->lists[i], 0);
+        Entry_Id *id;
+        while (list_iter_next(&iter, &id)) {
+            str_append_sized(&arena, &image, (const char *) &offset, sizeof(offset));
+            offset += app_entry(app, *id)->size;
+        }
+    }
+    str_append_sized(&arena, &image, (const char *) &offset, sizeof(offset));
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        List_Iter iter = list_iter_at(&app->lists[i], 0);
+        Entry_Id *id;
+        while (list_iter_next(&iter, &id)) {
+            Entry *entry = app_entry(app, *id);
+            int64_t times[2] = { entry->created, entry->completed };
+            str_append_sized(&arena, &image, (const char *) times, sizeof(times));
+        }
+    }
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        List_Iter iter = list_iter_at(&app->lists[i], 0);
+        Entry_Id *id;
+        while (list_iter_next(&iter, &id)) {
+            str_append_sv(&arena, &image, entry_text(app_entry(app, *id)));
+        }
+    }
+
+    char *temp_path = arena_sprintf(&arena, "%s.tmp", path);
+    bool ok = false;
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd >= 0) {
+        ok = write_all(fd, image.items, image.count) && sync_file(fd);
+        ok = close(fd) == 0 && ok;
+        ok = ok && replace_file(temp_path, path);
+        if (ok) {
+            sync_parent_dir(path);
+        } else {
+            remove(temp_path);
+        }
+    }
+    arena_free(&arena);
+    return ok;
+}
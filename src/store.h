@@ -0,0 +1,115 @@
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "./arena.h"
+#include "./todo.h"
+
+#define STORE_DEFAULT_PATH "todo-tui.dat"
+
+// Snapshot layout (native byte order):
+//   char     magic[4]               "TTUI"
+//   uint32_t version                STORE_VERSION
+//   uint64_t generation
+//   uint32_t counts[TODO_LIST_COUNT]
+//   uint64_t offsets[total + 1]     total is the sum of counts, every list in order,
+//                                   entry i is blob[offsets[i]..offsets[i + 1]]
+//   int64_t  times[total][2]        created and completed time of entry i
+//   char     blob[]
+#define STORE_MAGIC "TTUI"
+#define STORE_VERSION 4
+
+// Journal layout, every mutation since the snapshot is appended as a record:
+//   char     magic[4]               "TTUJ"
+//   uint32_t version                STORE_VERSION
+//   uint64_t generation             generation of the state the records apply to
+//   followed by records:
+//   uint32_t checksum               FNV-1a of the rest of the record
+//   uint8_t  op                     Store_Op
+//   uint8_t  list_index
+//   uint16_t reserved
+//   uint32_t entry_index
+//   uint32_t size
+//   int64_t  time                   created time for ADD, completed time for MOVE
+//   char     text[size]
+#define STORE_JOURNAL_MAGIC "TTUJ"
+
+// The journal is compacted into a fresh snapshot once it grows past
+// STORE_COMPACT_RATIO times the size of the snapshot
+#define STORE_COMPACT_RATIO 1.0
+#define STORE_COMPACT_MIN_SIZE (64*1024)
+// A snapshot that could not be written is tried again at most this often
+#define STORE_RETRY_MS 5000
+
+typedef enum {
+    STORE_OP_ADD = 1,
+    STORE_OP_DELETE,
+    STORE_OP_MOVE,
+    STORE_OP_EDIT,
+} Store_Op;
+
+typedef enum {
+    // fsync after every record, nothing is lost on power failure
+    STORE_SYNC_EVERY_OP,
+    // fsync at most every `sync_interval_ms`, bounds the loss to that window
+    STORE_SYNC_INTERVAL,
+    // fsync only on exit, a crash of the process itself still loses nothing
+    // since every record is written to the kernel right away
+    STORE_SYNC_ON_EXIT,
+} Store_Sync;
+
+struct Store {
+    Arena arena;
+    const char *path;
+    const char *journal_path;
+    const char *old_journal_path;
+    int journal_fd;
+    // The mapped snapshot the entries loaded at startup point into
+    String_View snapshot;
+
+    uint64_t generation;
+    size_t snapshot_size;
+    size_t journal_size;
+
+    Store_Sync sync;
+    uint64_t sync_interval_ms;
+    uint64_t sync_deadline_ms;
+    bool unsynced;
+
+    // pid of the forked process writing the snapshot, 0 if there is none
+    int compactor;
+
+    // NOTE(nic): When a record could not be appended, or a compaction failed halfway,
+    // the files on disk no longer add up to the lists. The next compaction then writes
+    // a snapshot of the next generation right away, no matter the size of the journal,
+    // and keeps retrying every STORE_RETRY_MS until one makes it to disk.
+    bool resave;
+    uint64_t retry_deadline_ms;
+    TODO_App *app;
+    // The last thing that went wrong, shown to the user until a snapshot makes it, empty if nothing
+    char error[256];
+};
+
+// Maps the last snapshot from `path` and replays the journal on top of it.
+// Entries are views straight into the mapping until they are edited.
+bool store_open(Store *store, Pool *pool, TODO_App *app, const char *path);
+// Writes a pending snapshot if the journal is missing changes
+void store_close(Store *store);
+
+void store_log(Store *store, Store_Op op, TODO_List_Index list_index, size_t entry_index, const char *text, size_t size, int64_t time);
+
+// Flushes pending records to disk if the sync policy asks for it by now
+void store_sync(Store *store, bool force);
+// Milliseconds until `store_sync()` has work to do, -1 if never
+int store_sync_timeout(Store *store);
+
+// Starts writing a fresh snapshot in the background if the journal grew big enough
+void store_maybe_compact(Store *store, TODO_App *app);
+
+// Replaces `path` with the current lists through a temporary file that is fsync'ed
+// and renamed over it, so a crash leaves either the old or the new contents.
+bool store_save(TODO_App *app, const char *path, uint64_t generation);
+
+#endif // STORE_H_
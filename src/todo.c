@@ -0,0 +1,330 @@
+#include <assert.h>
+#include <string.h>
+
+#include "./todo.h"
+#include "./store.h"
+#include "./plat.h"
+
+// NOTE(nic): Entry text is immutable once it is in the table, it either lives in the
+// mapped snapshot or in the pool. Edits put a new copy in the pool (copy-on-write).
+static const char *text_copy(Pool *pool, const char *todo, size_t todo_len) {
+    return pool_memdup(pool, todo, todo_len);
+}
+
+// Text still in the mapped snapshot was never allocated from the pool
+static bool text_is_mapped(TODO_App *app, const char *text) {
+    uintptr_t begin = (uintptr_t) app->mapped.data;
+    uintptr_t end = begin + app->mapped.size;
+    return (uintptr_t) text >= begin && (uintptr_t) text < end;
+}
+
+static void text_release(Pool *pool, TODO_App *app, const char *text, size_t size) {
+    if (!text_is_mapped(app, text)) {
+        pool_free(pool, (void *) text, size);
+    }
+}
+
+static void entry_reserve_pages(Pool *pool, Entry_Table *table, size_t page_count) {
+    if (page_count <= table->page_capacity) {
+        return;
+    }
+    size_t new_capacity = MAX(table->page_capacity*2, page_count);
+    table->pages = pool_realloc(pool, table->pages,
+                                table->page_capacity*sizeof(*table->pages),
+                                new_capacity*sizeof(*table->pages));
+    memset(table->pages + table->page_capacity, 0, (new_capacity - table->page_capacity)*sizeof(*table->pages));
+    table->page_capacity = new_capacity;
+}
+
+static Entry *entry_page(Pool *pool, Entry_Table *table, size_t page) {
+    if (table->pages[page] != NULL) {
+        return table->pages[page];
+    }
+    Entry *records = pool_alloc(pool, ENTRY_PAGE_SIZE*sizeof(*records));
+    memset(records, 0, ENTRY_PAGE_SIZE*sizeof(*records));
+    Entry_Snapshot *snapshot = &table->snapshot;
+    size_t first = page*ENTRY_PAGE_SIZE;
+    for (size_t id = first; id < first + ENTRY_PAGE_SIZE && id < snapshot->count; ++id) {
+        uint64_t begin = snapshot->offsets[id];
+        uint64_t end = snapshot->offsets[id + 1];
+        // NOTE(nic): startup does not read every offset, so they are checked here and
+        // a corrupted one leaves its entry empty
+        if (begin > end || end > snapshot->text_size) {
+            begin = end = 0;
+        }
+        records[id - first] = (Entry) {
+            .text = snapshot->text + begin,
+            .size = end - begin,
+            .flags = id >= snapshot->dones ? ENTRY_DONE : 0,
+            .created = snapshot->times[2*id],
+            .completed = snapshot->times[2*id + 1],
+        };
+    }
+    table->pages[page] = records;
+    return records;
+}
+
+static Entry_Id entry_new(Pool *pool, Entry_Table *table) {
+    if (table->free != 0) {
+        Entry_Id id = table->free - 1;
+        table->free = entry_page(pool, table, id >> ENTRY_PAGE_SHIFT)[id & (ENTRY_PAGE_SIZE - 1)].size;
+        return id;
+    }
+    assert(table->count < UINT32_MAX);
+    entry_reserve_pages(pool, table, (table->count >> ENTRY_PAGE_SHIFT) + 1);
+    entry_page(pool, table, table->count >> ENTRY_PAGE_SHIFT);
+    return table->count++;
+}
+
+static void entry_delete(Pool *pool, TODO_App *app, Entry_Id id) {
+    Entry *entry = app_entry(app, id);
+    search_index_remove(&app->search, id, entry_text(entry));
+    layout_forget(&app->layout, id);
+    text_release(pool, app, entry->text, entry->size);
+    app->entries.text_bytes -= entry->size;
+    *entry = (Entry) {0};
+    entry->flags = ENTRY_FREE;
+    entry->size = app->entries.free;
+    app->entries.free = id + 1;
+}
+
+static void list_append_entry(Pool *pool, List *list, Entry_Id id) {
+    list_append(pool, list, id);
+    list->cursor = list->count - 1;
+}
+
+static Entry_Id list_remove_entry(Pool *pool, List *list, size_t entry_index) {
+    Entry_Id id = list_remove(pool, list, entry_index);
+    list->cursor = CLAMP(list->cursor, 0, list->count - 1);
+    return id;
+}
+
+Entry *app_entry(TODO_App *app, Entry_Id id) {
+    Entry_Table *table = &app->entries;
+    assert(id < table->count);
+    return &entry_page(table->snapshot.pool, table, id >> ENTRY_PAGE_SHIFT)[id & (ENTRY_PAGE_SIZE - 1)];
+}
+
+Entry *app_list_entry(TODO_App *app, TODO_List_Index list_index, size_t entry_index) {
+    return app_entry(app, list_at(&app->lists[list_index], entry_index));
+}
+
+String_View entry_text(Entry *entry) {
+    return sv_from_parts(entry->text, entry->size);
+}
+
+void app_load_snapshot(Pool *pool, TODO_App *app, Entry_Snapshot snapshot) {
+    Entry_Table *table = &app->entries;
+    assert(table->count == 0 && snapshot.dones <= snapshot.count);
+    snapshot.pool = pool;
+    table->snapshot = snapshot;
+    table->count = snapshot.count;
+    table->text_bytes = snapshot.count > 0 ? snapshot.offsets[snapshot.count] - snapshot.offsets[0] : 0;
+    entry_reserve_pages(pool, table, (snapshot.count + ENTRY_PAGE_SIZE - 1) >> ENTRY_PAGE_SHIFT);
+    list_append_range(pool, &app->lists[TODO_LIST_TODOS], 0, snapshot.dones);
+    list_append_range(pool, &app->lists[TODO_LIST_DONES], snapshot.dones, snapshot.count - snapshot.dones);
+}
+
+void app_load_all_entries(TODO_App *app) {
+    Entry_Table *table = &app->entries;
+    for (size_t page = 0; page*ENTRY_PAGE_SIZE < table->count; ++page) {
+        entry_page(table->snapshot.pool, table, page);
+    }
+}
+
+void app_add_entry(Pool *pool, TODO_App *app, TODO_List_Index list_index, const char *todo, size_t todo_len, int64_t now) {
+    List *list = &app->lists[list_index];
+    if (app->store != NULL) {
+        store_log(app->store, STORE_OP_ADD, list_index, list->count, todo, todo_len, now);
+    }
+    Entry_Id id = entry_new(pool, &app->entries);
+    Entry *entry = app_entry(app, id);
+    entry->text = text_copy(pool, todo, todo_len);
+    entry->size = todo_len;
+    app->entries.text_bytes += todo_len;
+    entry->flags = list_index == TODO_LIST_DONES ? ENTRY_DONE : 0;
+    entry->created = now;
+    entry->completed = list_index == TODO_LIST_DONES ? now : 0;
+    list_append_entry(pool, list, id);
+    search_index_add(&app->search, id, entry_text(entry));
+}
+
+void app_delete_entry(Pool *pool, TODO_App *app, TODO_List_Index list_index, size_t entry_index) {
+    List *list = &app->lists[list_index];
+    if (list->count <= 0) {
+        return;
+    }
+    assert(entry_index < list->count);
+    if (app->store != NULL) {
+        store_log(app->store, STORE_OP_DELETE, list_index, entry_index, NULL, 0, 0);
+    }
+    entry_delete(pool, app, list_remove_entry(pool, list, entry_index));
+}
+
+void app_move_entry(Pool *pool, TODO_App *app, TODO_List_Index from_list_index, size_t entry_index, int64_t now) {
+    List *list = &app->lists[from_list_index];
+    if (list->count <= 0) {
+        return;
+    }
+    assert(entry_index < list->count);
+    if (app->store != NULL) {
+        store_log(app->store, STORE_OP_MOVE, from_list_index, entry_index, NULL, 0, now);
+    }
+    Entry_Id id = list_remove_entry(pool, list, entry_index);
+    TODO_List_Index to_list_index = !from_list_index;
+    Entry *entry = app_entry(app, id);
+    if (to_list_index == TODO_LIST_DONES) {
+        entry->flags |= ENTRY_DONE;
+        entry->completed = now;
+    } else {
+        entry->flags &= ~ENTRY_DONE;
+        entry->completed = 0;
+    }
+    list_append_entry(pool, &app->lists[to_list_index], id);
+}
+
+void app_edit_entry(Pool *pool, TODO_App *app, TODO_List_Index list_index, size_t entry_index, const char *todo, size_t todo_len) {
+    List *list = &app->lists[list_index];
+    assert(entry_index < list->count);
+    if (app->store != NULL) {
+        store_log(app->store, STORE_OP_EDIT, list_index, entry_index, todo, todo_len, 0);
+    }
+    Entry_Id id = list_at(list, entry_index);
+    Entry *entry = app_entry(app, id);
+    const char *old = entry->text;
+    size_t old_size = entry->size;
+    app->entries.text_bytes += todo_len - old_size;
+    search_index_remove(&app->search, id, entry_text(entry));
+    layout_forget(&app->layout, id);
+    entry->text = text_copy(pool, todo, todo_len);
+    entry->size = todo_len;
+    search_index_add(&app->search, id, entry_text(entry));
+    text_release(pool, app, old, old_size);
+}
+
+// NOTE(nic): Free blocks scattered over many regions keep all of them alive, so
+// instead of waiting for them to be reused everything reachable from the app is
+// copied into a fresh pool and the old regions are freed at once. The lists come
+// out with every chunk full. Ids stay the same since the table is copied as it is,
+// pages and ranges of the snapshot that were never used stay that way.
+void app_compact(Pool *pool, TODO_App *app) {
+    uint64_t start = get_time_ns();
+    Pool fresh = {0};
+    fresh.arena.stats = pool->arena.stats;
+    Entry_Table *table = &app->entries;
+    if (table->pages != NULL) {
+        table->pages = pool_memdup(&fresh, table->pages, table->page_capacity*sizeof(*table->pages));
+    }
+    for (size_t page = 0; page < table->page_capacity; ++page) {
+        if (table->pages[page] == NULL) {
+            continue;
+        }
+        Entry *records = pool_memdup(&fresh, table->pages[page], ENTRY_PAGE_SIZE*sizeof(*records));
+        table->pages[page] = records;
+        for (size_t i = 0; i < ENTRY_PAGE_SIZE && page*ENTRY_PAGE_SIZE + i < table->count; ++i) {
+            Entry *entry = &records[i];
+            if (!(entry->flags & ENTRY_FREE) && !text_is_mapped(app, entry->text)) {
+                entry->text = text_copy(&fresh, entry->text, entry->size);
+            }
+        }
+    }
+    for (size_t i = 0; i < TODO_LIST_COUNT; ++i) {
+        List *list = &app->lists[i];
+        List compacted = {0};
+        compacted.cursor = list->cursor;
+        compacted.offset = list->offset;
+        compacted.rows = list->rows;
+        list_copy(&fresh, &compacted, list);
+        *list = compacted;
+    }
+    Line_Edit *line = &app->line_edit;
+    if (line->items != NULL) {
+        line->items = pool_memdup(&fresh, line->items, line->capacity);
+    }
+    // Every text moved, the cached layouts would only ever miss
+    layout_reset(&app->layout);
+    pool_replace(pool, &fresh, get_time_ns() - start);
+}
+
+size_t line_edit_count(Line_Edit *line) {
+    return line->gap_start + (line->capacity - line->gap_end);
+}
+
+size_t line_edit_cursor(Line_Edit *line) {
+    return line->gap_start;
+}
+
+String_View line_edit_before(Line_Edit *line) {
+    return sv_from_parts(line->items, line->gap_start);
+}
+
+String_View line_edit_after(Line_Edit *line) {
+    return sv_from_parts(line->items + line->gap_end, line->capacity - line->gap_end);
+}
+
+String_View line_edit_view(Line_Edit *line) {
+    line_edit_move_to(line, line_edit_count(line));
+    return line_edit_before(line);
+}
+
+static void line_edit_reserve(Pool *pool, Line_Edit *line, size_t size) {
+    size_t gap = line->gap_end - line->gap_start;
+    if (gap >= size) {
+        return;
+    }
+    size_t count = line_edit_count(line);
+    size_t new_capacity = line->capacity == 0 ? ARENA_DA_INIT_CAP : line->capacity*2;
+    while (new_capacity < count + size) {
+        new_capacity *= 2;
+    }
+    char *items = pool_alloc(pool, new_capacity);
+    size_t after = line->capacity - line->gap_end;
+    if (line->items != NULL) {
+        memcpy(items, line->items, line->gap_start);
+        memcpy(items + new_capacity - after, line->items + line->gap_end, after);
+        pool_free(pool, line->items, line->capacity);
+    }
+    line->items = items;
+    line->gap_end = new_capacity - after;
+    line->capacity = new_capacity;
+}
+
+void line_edit_insert(Pool *pool, Line_Edit *line, const char *text, size_t size) {
+    line_edit_reserve(pool, line, size);
+    memcpy(line->items + line->gap_start, text, size);
+    line->gap_start += size;
+}
+
+void line_edit_erase_before(Line_Edit *line, size_t n) {
+    line->gap_start -= MIN(n, line->gap_start);
+}
+
+void line_edit_erase_after(Line_Edit *line, size_t n) {
+    line->gap_end += MIN(n, line->capacity - line->gap_end);
+}
+
+void line_edit_move_to(Line_Edit *line, size_t cursor) {
+    cursor = MIN(cursor, line_edit_count(line));
+    if (cursor < line->gap_start) {
+        size_t n = line->gap_start - cursor;
+        memmove(line->items + line->gap_end - n, line->items + cursor, n);
+        line->gap_start -= n;
+        line->gap_end -= n;
+    } else if (cursor > line->gap_start) {
+        size_t n = cursor - line->gap_start;
+        memmove(line->items + line->gap_start, line->items + line->gap_end, n);
+        line->gap_start += n;
+        line->gap_end += n;
+    }
+}
+
+void line_edit_set(Pool *pool, Line_Edit *line, String_View text) {
+    line_edit_clear(line);
+    line_edit_insert(pool, line, text.data, text.size);
+}
+
+void line_edit_clear(Line_Edit *line) {
+    line->gap_start = 0;
+    line->gap_end = line->capacity;
+    line->offset = 0;
+}
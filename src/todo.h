@@ -0,0 +1,156 @@
+#ifndef TODO_H_
+#define TODO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "./arena.h"
+#include "./utils.h"
+#include "./pool.h"
+#include "./list.h"
+#include "./search.h"
+#include "./fuzzy.h"
+#include "./layout.h"
+
+// Defined in store.h, every mutation is journaled through it when set
+typedef struct Store Store;
+
+typedef uint32_t Entry_Id;
+
+typedef enum {
+    ENTRY_DONE = 1 << 0,
+    // Deleted, `size` links to the next deleted id the same way `Entry_Table.free` does
+    ENTRY_FREE = 1 << 1,
+} Entry_Flags;
+
+// NOTE(nic): Every entry gets a record in the entry table of the app and keeps its
+// id until it is deleted, the lists only hold ids. Moving an entry between the lists
+// relinks the id and the text never moves. The text is either in the mapped snapshot
+// or in the pool.
+typedef struct {
+    const char *text;
+    uint32_t size;
+    uint32_t flags;
+    // Seconds since the epoch, `completed` is 0 while the entry is not done
+    int64_t created;
+    int64_t completed;
+} Entry;
+
+// Records of the entries in the snapshot, see `app_load_snapshot()`
+typedef struct {
+    // Where the records of a page are allocated the first time it is used
+    Pool *pool;
+    const uint64_t *offsets;
+    const int64_t *times;
+    const char *text;
+    size_t text_size;
+    size_t count;
+    // Ids from here on start out in the done list
+    size_t dones;
+} Entry_Snapshot;
+
+#define ENTRY_PAGE_SHIFT 10
+#define ENTRY_PAGE_SIZE ((size_t) 1 << ENTRY_PAGE_SHIFT)
+
+// NOTE(nic): The records live in pages of ENTRY_PAGE_SIZE, a page that holds entries of
+// the snapshot stays NULL until one of them is used and is then filled from its tables.
+// Startup only sets up the page directory, whatever is drawn faults in its own pages.
+typedef struct {
+    Entry **pages;
+    size_t page_capacity;
+    size_t count;
+    // First of the deleted ids plus one, 0 if there are none
+    Entry_Id free;
+    // Text of all entries that are not deleted
+    size_t text_bytes;
+    Entry_Snapshot snapshot;
+} Entry_Table;
+
+// Gap buffer: the text is items[0..gap_start] followed by items[gap_end..capacity].
+// The cursor always sits at the gap, so typing and deleting around it is O(1) amortized
+// and only moving the cursor shifts bytes across the gap.
+typedef struct {
+    char *items;
+    size_t capacity;
+    size_t gap_start;
+    size_t gap_end;
+    size_t offset;
+} Line_Edit;
+
+typedef enum {
+    TODO_STATE_IDLE = 0,
+    TODO_STATE_ADD,
+    TODO_STATE_EDIT,
+    TODO_STATE_SEARCH,
+    TODO_STATE_FUZZY,
+} TODO_State;
+
+typedef enum {
+    TODO_LIST_TODOS,
+    TODO_LIST_DONES,
+    TODO_LIST_COUNT,
+} TODO_List_Index;
+
+struct TODO_App {
+    Entry_Table entries;
+    List lists[TODO_LIST_COUNT];
+    TODO_State state;
+    Store *store;
+    // Entry text inside of this range is in the mapped snapshot, not in the pool
+    String_View mapped;
+
+    // TODO_STATE_IDLE
+    TODO_List_Index list_index;
+    // In columns
+    float scroll_effect;
+    float wait_effect;
+    bool animating;
+    // Long entries take as many rows as they need instead of scrolling sideways
+    bool wrap;
+    Layout_Cache layout;
+
+    // TODO_STATE_ADD, TODO_STATE_EDIT and the queries of TODO_STATE_SEARCH and TODO_STATE_FUZZY
+    Line_Edit line_edit;
+
+    // TODO_STATE_SEARCH
+    Search search;
+
+    // TODO_STATE_FUZZY
+    Fuzzy fuzzy;
+};
+
+Entry *app_entry(TODO_App *app, Entry_Id id);
+// Entry at `entry_index` of a list
+Entry *app_list_entry(TODO_App *app, TODO_List_Index list_index, size_t entry_index);
+String_View entry_text(Entry *entry);
+
+// Entry text, the entry table and the lists live in `pool`, deleted and replaced
+// text goes back to it. `now` is the time recorded for the entry.
+void app_add_entry(Pool *pool, TODO_App *app, TODO_List_Index list_index, const char *todo, size_t todo_len, int64_t now);
+void app_delete_entry(Pool *pool, TODO_App *app, TODO_List_Index list_index, size_t entry_index);
+void app_move_entry(Pool *pool, TODO_App *app, TODO_List_Index from_list_index, size_t entry_index, int64_t now);
+void app_edit_entry(Pool *pool, TODO_App *app, TODO_List_Index list_index, size_t entry_index, const char *todo, size_t todo_len);
+// Takes the entries of a snapshot as ids 0 to `snapshot.count - 1`, the todo list first.
+// Neither the records nor the lists are written until they are used.
+void app_load_snapshot(Pool *pool, TODO_App *app, Entry_Snapshot snapshot);
+// Fills in every page of the entry table, so it can be read from other threads
+void app_load_all_entries(TODO_App *app);
+// Moves everything the app holds into a fresh pool and frees the old one, see `pool_should_compact()`
+void app_compact(Pool *pool, TODO_App *app);
+
+size_t line_edit_count(Line_Edit *line);
+size_t line_edit_cursor(Line_Edit *line);
+// Text on each side of the cursor, valid until the next modification
+String_View line_edit_before(Line_Edit *line);
+String_View line_edit_after(Line_Edit *line);
+// Contiguous text, moves the cursor (and so the gap) to the end
+String_View line_edit_view(Line_Edit *line);
+void line_edit_insert(Pool *pool, Line_Edit *line, const char *text, size_t size);
+void line_edit_erase_before(Line_Edit *line, size_t n);
+void line_edit_erase_after(Line_Edit *line, size_t n);
+void line_edit_move_to(Line_Edit *line, size_t cursor);
+void line_edit_set(Pool *pool, Line_Edit *line, String_View text);
+void line_edit_clear(Line_Edit *line);
+
+#endif // TODO_H_
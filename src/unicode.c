@@ -0,0 +1,308 @@
+#include "./unicode.h"
+#include "./utils.h"
+
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} Unicode_Range;
+
+// Combining marks, format characters and variation selectors
+static const Unicode_Range zero_width[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+    { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+    { 0x061C, 0x061C }, { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC },
+    { 0x06DF, 0x06E4 }, { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0711, 0x0711 },
+    { 0x0730, 0x074A }, { 0x07A6, 0x07B0 }, { 0x07EB, 0x07F3 }, { 0x0816, 0x0819 },
+    { 0x081B, 0x0823 }, { 0x0825, 0x0827 }, { 0x0829, 0x082D }, { 0x0859, 0x085B },
+    { 0x08D3, 0x08E1 }, { 0x08E3, 0x0902 }, { 0x093A, 0x093A }, { 0x093C, 0x093C },
+    { 0x0941, 0x0948 }, { 0x094D, 0x094D }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 },
+    { 0x0981, 0x0981 }, { 0x09BC, 0x09BC }, { 0x09C1, 0x09C4 }, { 0x09CD, 0x09CD },
+    { 0x09E2, 0x09E3 }, { 0x0A01, 0x0A02 }, { 0x0A3C, 0x0A3C }, { 0x0A41, 0x0A51 },
+    { 0x0A70, 0x0A71 }, { 0x0A75, 0x0A75 }, { 0x0A81, 0x0A82 }, { 0x0ABC, 0x0ABC },
+    { 0x0AC1, 0x0AC8 }, { 0x0ACD, 0x0ACD }, { 0x0AE2, 0x0AE3 }, { 0x0B01, 0x0B01 },
+    { 0x0B3C, 0x0B3C }, { 0x0B3F, 0x0B3F }, { 0x0B41, 0x0B44 }, { 0x0B4D, 0x0B4D },
+    { 0x0B82, 0x0B82 }, { 0x0BC0, 0x0BC0 }, { 0x0BCD, 0x0BCD }, { 0x0C00, 0x0C00 },
+    { 0x0C3E, 0x0C40 }, { 0x0C46, 0x0C56 }, { 0x0C62, 0x0C63 }, { 0x0CBC, 0x0CBC },
+    { 0x0CCC, 0x0CCD }, { 0x0CE2, 0x0CE3 }, { 0x0D41, 0x0D44 }, { 0x0D4D, 0x0D4D },
+    { 0x0DCA, 0x0DCA }, { 0x0DD2, 0x0DD6 }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A },
+    { 0x0E47, 0x0E4E }, { 0x0EB1, 0x0EB1 }, { 0x0EB4, 0x0EBC }, { 0x0EC8, 0x0ECD },
+    { 0x0F18, 0x0F19 }, { 0x0F35, 0x0F35 }, { 0x0F37, 0x0F37 }, { 0x0F39, 0x0F39 },
+    { 0x0F71, 0x0F7E }, { 0x0F80, 0x0F84 }, { 0x0F86, 0x0F87 }, { 0x0F8D, 0x0FBC },
+    { 0x0FC6, 0x0FC6 }, { 0x102D, 0x1030 }, { 0x1032, 0x1037 }, { 0x1039, 0x103A },
+    { 0x103D, 0x103E }, { 0x1058, 0x1059 }, { 0x105E, 0x1060 }, { 0x1071, 0x1074 },
+    { 0x1082, 0x1082 }, { 0x1085, 0x1086 }, { 0x108D, 0x108D }, { 0x109D, 0x109D },
+    { 0x1160, 0x11FF }, { 0x135D, 0x135F }, { 0x1712, 0x1714 }, { 0x1732, 0x1734 },
+    { 0x1752, 0x1753 }, { 0x1772, 0x1773 }, { 0x17B4, 0x17B5 }, { 0x17B7, 0x17BD },
+    { 0x17C6, 0x17C6 }, { 0x17C9, 0x17D3 }, { 0x17DD, 0x17DD }, { 0x180B, 0x180F },
+    { 0x1885, 0x1886 }, { 0x18A9, 0x18A9 }, { 0x1920, 0x1922 }, { 0x1927, 0x1928 },
+    { 0x1932, 0x1932 }, { 0x1939, 0x193B }, { 0x1A17, 0x1A18 }, { 0x1A1B, 0x1A1B },
+    { 0x1A56, 0x1A56 }, { 0x1A58, 0x1A60 }, { 0x1A62, 0x1A62 }, { 0x1A65, 0x1A6C },
+    { 0x1A73, 0x1A7F }, { 0x1AB0, 0x1AFF }, { 0x1B00, 0x1B03 }, { 0x1B34, 0x1B34 },
+    { 0x1B36, 0x1B3A }, { 0x1B3C, 0x1B3C }, { 0x1B42, 0x1B42 }, { 0x1B6B, 0x1B73 },
+    { 0x1B80, 0x1B81 }, { 0x1BA2, 0x1BA5 }, { 0x1BA8, 0x1BA9 }, { 0x1BAB, 0x1BAD },
+    { 0x1BE6, 0x1BE6 }, { 0x1BE8, 0x1BE9 }, { 0x1BED, 0x1BED }, { 0x1BEF, 0x1BF1 },
+    { 0x1C2C, 0x1C33 }, { 0x1C36, 0x1C37 }, { 0x1CD0, 0x1CD2 }, { 0x1CD4, 0x1CE0 },
+    { 0x1CE2, 0x1CE8 }, { 0x1CED, 0x1CED }, { 0x1CF4, 0x1CF4 }, { 0x1CF8, 0x1CF9 },
+    { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x2064 },
+    { 0x20D0, 0x20F0 }, { 0x2CEF, 0x2CF1 }, { 0x2D7F, 0x2D7F }, { 0x2DE0, 0x2DFF },
+    { 0x302A, 0x302D }, { 0x3099, 0x309A }, { 0xA66F, 0xA672 }, { 0xA674, 0xA67D },
+    { 0xA69E, 0xA69F }, { 0xA6F0, 0xA6F1 }, { 0xA802, 0xA802 }, { 0xA806, 0xA806 },
+    { 0xA80B, 0xA80B }, { 0xA825, 0xA826 }, { 0xA8C4, 0xA8C5 }, { 0xA8E0, 0xA8F1 },
+    { 0xA926, 0xA92D }, { 0xA947, 0xA951 }, { 0xA980, 0xA982 }, { 0xA9B3, 0xA9B3 },
+    { 0xA9B6, 0xA9B9 }, { 0xA9BC, 0xA9BD }, { 0xAA29, 0xAA2E }, { 0xAA31, 0xAA32 },
+    { 0xAA35, 0xAA36 }, { 0xAA43, 0xAA43 }, { 0xAA4C, 0xAA4C }, { 0xAAB0, 0xAAB0 },
+    { 0xAAB2, 0xAAB4 }, { 0xAAB7, 0xAAB8 }, { 0xAABE, 0xAABF }, { 0xAAC1, 0xAAC1 },
+    { 0xAAEC, 0xAAED }, { 0xAAF6, 0xAAF6 }, { 0xABE5, 0xABE5 }, { 0xABE8, 0xABE8 },
+    { 0xABED, 0xABED }, { 0xD7B0, 0xD7FF }, { 0xFB1E, 0xFB1E }, { 0xFE00, 0xFE0F },
+    { 0xFE20, 0xFE2F }, { 0xFEFF, 0xFEFF }, { 0xFFF9, 0xFFFB }, { 0x101FD, 0x101FD },
+    { 0x102E0, 0x102E0 }, { 0x10376, 0x1037A }, { 0x10A01, 0x10A0F }, { 0x10A38, 0x10A3F },
+    { 0x10AE5, 0x10AE6 }, { 0x10D24, 0x10D27 }, { 0x10F46, 0x10F50 }, { 0x11001, 0x11001 },
+    { 0x11038, 0x11046 }, { 0x1107F, 0x11081 }, { 0x110B3, 0x110B6 }, { 0x110B9, 0x110BA },
+    { 0x11100, 0x11102 }, { 0x11127, 0x1112B }, { 0x1112D, 0x11134 }, { 0x16AF0, 0x16AF4 },
+    { 0x16B30, 0x16B36 }, { 0x16F8F, 0x16F92 }, { 0x1BC9D, 0x1BC9E }, { 0x1D167, 0x1D169 },
+    { 0x1D17B, 0x1D182 }, { 0x1D185, 0x1D18B }, { 0x1D1AA, 0x1D1AD }, { 0x1D242, 0x1D244 },
+    { 0x1E000, 0x1E02A }, { 0x1E8D0, 0x1E8D6 }, { 0x1E944, 0x1E94A }, { 0xE0001, 0xE0001 },
+    { 0xE0020, 0xE007F }, { 0xE0100, 0xE01EF },
+};
+
+// East Asian wide and fullwidth, and the emoji that are shown wide by default
+static const Unicode_Range wide[] = {
+    { 0x1100, 0x115F }, { 0x231A, 0x231B }, { 0x2329, 0x232A }, { 0x23E9, 0x23EC },
+    { 0x23F0, 0x23F0 }, { 0x23F3, 0x23F3 }, { 0x25FD, 0x25FE }, { 0x2614, 0x2615 },
+    { 0x2648, 0x2653 }, { 0x267F, 0x267F }, { 0x2693, 0x2693 }, { 0x26A1, 0x26A1 },
+    { 0x26AA, 0x26AB }, { 0x26BD, 0x26BE }, { 0x26C4, 0x26C5 }, { 0x26CE, 0x26CE },
+    { 0x26D4, 0x26D4 }, { 0x26EA, 0x26EA }, { 0x26F2, 0x26F3 }, { 0x26F5, 0x26F5 },
+    { 0x26FA, 0x26FA }, { 0x26FD, 0x26FD }, { 0x2705, 0x2705 }, { 0x270A, 0x270B },
+    { 0x2728, 0x2728 }, { 0x274C, 0x274C }, { 0x274E, 0x274E }, { 0x2753, 0x2755 },
+    { 0x2757, 0x2757 }, { 0x2795, 0x2797 }, { 0x27B0, 0x27B0 }, { 0x27BF, 0x27BF },
+    { 0x2B1B, 0x2B1C }, { 0x2B50, 0x2B50 }, { 0x2B55, 0x2B55 }, { 0x2E80, 0x303E },
+    { 0x3041, 0x3247 }, { 0x3250, 0x4DBF }, { 0x4E00, 0xA4C6 }, { 0xA960, 0xA97C },
+    { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE10, 0xFE19 }, { 0xFE30, 0xFE6B },
+    { 0xFF01, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x16FE0, 0x16FE4 }, { 0x17000, 0x18AFF },
+    { 0x1B000, 0x1B16F }, { 0x1F004, 0x1F004 }, { 0x1F0CF, 0x1F0CF }, { 0x1F18E, 0x1F18E },
+    { 0x1F191, 0x1F19A }, { 0x1F200, 0x1F251 }, { 0x1F300, 0x1F320 }, { 0x1F32D, 0x1F335 },
+    { 0x1F337, 0x1F37C }, { 0x1F37E, 0x1F393 }, { 0x1F3A0, 0x1F3CA }, { 0x1F3CF, 0x1F3D3 },
+    { 0x1F3E0, 0x1F3F0 }, { 0x1F3F4, 0x1F3F4 }, { 0x1F3F8, 0x1F43E }, { 0x1F440, 0x1F440 },
+    { 0x1F442, 0x1F4FC }, { 0x1F4FF, 0x1F53D }, { 0x1F54B, 0x1F54E }, { 0x1F550, 0x1F567 },
+    { 0x1F57A, 0x1F57A }, { 0x1F595, 0x1F596 }, { 0x1F5A4, 0x1F5A4 }, { 0x1F5FB, 0x1F64F },
+    { 0x1F680, 0x1F6C5 }, { 0x1F6CC, 0x1F6CC }, { 0x1F6D0, 0x1F6D2 }, { 0x1F6D5, 0x1F6D7 },
+    { 0x1F6EB, 0x1F6EC }, { 0x1F6F4, 0x1F6FC }, { 0x1F7E0, 0x1F7EB }, { 0x1F90C, 0x1F93A },
+    { 0x1F93C, 0x1F945 }, { 0x1F947, 0x1F9FF }, { 0x1FA70, 0x1FAFF }, { 0x20000, 0x2FFFD },
+    { 0x30000, 0x3FFFD },
+};
+
+static bool in_ranges(const Unicode_Range *ranges, size_t count, uint32_t ch) {
+    if (ch < ranges[0].first || ch > ranges[count - 1].last) {
+        return false;
+    }
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        if (ch > ranges[mid].last) {
+            lo = mid + 1;
+        } else if (ch < ranges[mid].first) {
+            hi = mid;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t utf8_decode(const char *text, size_t size, uint32_t *ch) {
+    const unsigned char *s = (const unsigned char *) text;
+    size_t len = 0;
+    uint32_t cp = 0;
+    if (s[0] < 0x80) {
+        *ch = s[0];
+        return 1;
+    } else if ((s[0] & 0xE0) == 0xC0) {
+        len = 2;
+        cp = s[0] & 0x1F;
+    } else if ((s[0] & 0xF0) == 0xE0) {
+        len = 3;
+        cp = s[0] & 0x0F;
+    } else if ((s[0] & 0xF8) == 0xF0) {
+        len = 4;
+        cp = s[0] & 0x07;
+    }
+    if (len == 0 || len > size) {
+        *ch = UNICODE_REPLACEMENT;
+        return 1;
+    }
+    for (size_t i = 1; i < len; ++i) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *ch = UNICODE_REPLACEMENT;
+            return 1;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+    *ch = cp;
+    return len;
+}
+
+size_t utf8_encode(uint32_t ch, char *out) {
+    if (ch < 0x80) {
+        out[0] = ch;
+        return 1;
+    } else if (ch < 0x800) {
+        out[0] = 0xC0 | (ch >> 6);
+        out[1] = 0x80 | (ch & 0x3F);
+        return 2;
+    } else if (ch < 0x10000) {
+        out[0] = 0xE0 | (ch >> 12);
+        out[1] = 0x80 | ((ch >> 6) & 0x3F);
+        out[2] = 0x80 | (ch & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (ch >> 18);
+    out[1] = 0x80 | ((ch >> 12) & 0x3F);
+    out[2] = 0x80 | ((ch >> 6) & 0x3F);
+    out[3] = 0x80 | (ch & 0x3F);
+    return 4;
+}
+
+int unicode_width(uint32_t ch) {
+    if (ch < 0x300) {
+        return 1;
+    }
+    if (in_ranges(zero_width, ARRAY_LEN(zero_width), ch)) {
+        return 0;
+    }
+    if (in_ranges(wide, ARRAY_LEN(wide), ch)) {
+        return 2;
+    }
+    return 1;
+}
+
+// Control characters are shown as a single replacement column and never join a cluster
+static bool is_control(uint32_t ch) {
+    return ch < 32 || (ch >= 0x7F && ch < 0xA0);
+}
+
+static bool is_regional(uint32_t ch) {
+    return ch >= 0x1F1E6 && ch <= 0x1F1FF;
+}
+
+// Attaches to the cluster before it
+static bool is_extend(uint32_t ch) {
+    return ch == UNICODE_ZWJ
+        || (ch >= 0x1F3FB && ch <= 0x1F3FF)
+        || (ch >= 0x300 && in_ranges(zero_width, ARRAY_LEN(zero_width), ch));
+}
+
+size_t grapheme_next(const char *text, size_t size, size_t *width) {
+    *width = 0;
+    if (size == 0) {
+        return 0;
+    }
+    uint32_t base;
+    size_t i = utf8_decode(text, size, &base);
+    if (is_control(base)) {
+        *width = 1;
+        if (base == '\r' && i < size && text[i] == '\n') {
+            i += 1;
+        }
+        return i;
+    }
+    size_t w = unicode_width(base);
+    if (is_regional(base) && i < size) {
+        uint32_t next;
+        size_t n = utf8_decode(text + i, size - i, &next);
+        if (is_regional(next)) {
+            i += n;
+            w = 2;
+        }
+    }
+    bool joined = false;
+    while (i < size) {
+        uint32_t ch;
+        size_t n = utf8_decode(text + i, size - i, &ch);
+        if (is_control(ch)) {
+            break;
+        }
+        if (joined) {
+            // NOTE(nic): whatever follows a ZWJ is part of the same emoji
+            joined = false;
+            i += n;
+            continue;
+        }
+        if (!is_extend(ch)) {
+            break;
+        }
+        if (ch == UNICODE_VS16 && w == 1) {
+            w = 2;
+        }
+        joined = ch == UNICODE_ZWJ;
+        i += n;
+    }
+    *width = w;
+    return i;
+}
+
+// Start of the codepoint that ends at `end`, a broken sequence counts byte by byte
+// just like `utf8_decode()` does it
+static size_t prev_codepoint(const char *text, size_t end, uint32_t *ch) {
+    size_t start = end - 1;
+    while (start > 0 && end - start < 4 && (text[start] & 0xC0) == 0x80) {
+        start -= 1;
+    }
+    if (utf8_decode(text + start, end - start, ch) != end - start) {
+        start = end - 1;
+        utf8_decode(text + start, 1, ch);
+    }
+    return start;
+}
+
+size_t grapheme_prev(const char *text, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    // NOTE(nic): Clusters can only be told apart going forward, so this walks back to a
+    // codepoint that surely starts one and segments forward from there
+    size_t start = size;
+    while (true) {
+        uint32_t ch;
+        start = prev_codepoint(text, start, &ch);
+        if (start == 0) {
+            break;
+        }
+        uint32_t before;
+        prev_codepoint(text, start, &before);
+        if (is_control(before) || is_control(ch)) {
+            if (ch == '\n' && before == '\r') {
+                continue;
+            }
+            break;
+        }
+        if (!is_extend(ch) && before != UNICODE_ZWJ && !(is_regional(ch) && is_regional(before))) {
+            break;
+        }
+    }
+    size_t last = 0;
+    size_t width;
+    while (start < size) {
+        last = grapheme_next(text + start, size - start, &width);
+        start += last;
+    }
+    return last;
+}
+
+size_t text_width(const char *text, size_t size) {
+    size_t cols = 0;
+    size_t i = 0;
+    while (i < size) {
+        // NOTE(nic): runs of ASCII are the common case and one column per byte
+        if ((unsigned char) text[i] >= 32 && (unsigned char) text[i] < 127
+            && (i + 1 == size || (unsigned char) text[i + 1] < 0x80)) {
+            cols += 1;
+            i += 1;
+            continue;
+        }
+        size_t width;
+        i += grapheme_next(text + i, size - i, &width);
+        cols += width;
+    }
+    return cols;
+}
@@ -0,0 +1,34 @@
+#ifndef UNICODE_H_
+#define UNICODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UNICODE_REPLACEMENT 0xFFFD
+#define UNICODE_ZWJ 0x200D
+#define UNICODE_VS16 0xFE0F
+
+// Decodes a single codepoint, invalid sequences decode as U+FFFD and consume one byte
+size_t utf8_decode(const char *text, size_t size, uint32_t *ch);
+size_t utf8_encode(uint32_t ch, char *out);
+
+// Columns a codepoint takes on its own: 0 for combining marks and other extenders,
+// 2 for East Asian wide and fullwidth characters and emoji, 1 for the rest
+int unicode_width(uint32_t ch);
+
+// NOTE(nic): Grapheme clusters are what the user sees as one character and what the
+// cursor moves over. The rules are a subset of UAX #29 that covers what shows up in
+// practice: a base followed by combining marks and variation selectors, emoji joined
+// by ZWJ or followed by skin tone modifiers, flags made of two regional indicators
+// and CR LF. The width of a cluster is the width of its base, or 2 when it asks for
+// the emoji presentation (VS16) or is a flag.
+
+// Size in bytes of the first cluster of `text` (0 if empty), its columns go to `width`
+size_t grapheme_next(const char *text, size_t size, size_t *width);
+// Size in bytes of the last cluster of `text` (0 if empty)
+size_t grapheme_prev(const char *text, size_t size);
+// Columns the whole text takes
+size_t text_width(const char *text, size_t size);
+
+#endif // UNICODE_H_
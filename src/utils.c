@@ -1,3 +1,5 @@
+#include <threads.h>
+
 #include "./utils.h"
 
 // NOTE(nic): We need alloca because cl.exe does not allow for variable-length arrays
@@ -74,26 +76,318 @@ String_View sv_from_parts(const char *data, size_t size) {
     return (String_View) { data, size };
 }
 
-bool sv_find(String_View sv, char ch, size_t *index) {
-    for (size_t i = 0; i < sv.size; ++i) {
-        if (sv.data[i] == ch) {
-            if (index != NULL) {
+// NOTE(nic): The scans below are the building blocks of everything that walks the
+// text of many entries (search, trimming, parsing), so on x86-64 they test 16 bytes
+// at a time with SSE2, which every x86-64 CPU has, or 32 bytes with AVX2 when the CPU
+// supports it. The CPU is asked once, the first time a scan runs.
+// Every scan has a scalar version that is used elsewhere and for the tails.
+#if defined(__x86_64__) || defined(_M_X64)
+#    define UTILS_SIMD 1
+#    include <immintrin.h>
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#        define UTILS_TARGET_AVX2
+#    else
+#        define UTILS_TARGET_AVX2 __attribute__((target("avx2")))
+#    endif
+#else
+#    define UTILS_SIMD 0
+#endif
+
+static Simd_Level utils_simd_supported = SIMD_SCALAR;
+static Simd_Level utils_simd_level = SIMD_SCALAR;
+// NOTE(nic): the first string scan can happen on any of the fuzzy workers at once
+static once_flag utils_simd_once = ONCE_FLAG_INIT;
+
+static void simd_detect_once(void) {
+    utils_simd_level = SIMD_SCALAR;
+#if UTILS_SIMD && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    utils_simd_level = SIMD_SSE2;
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        bool osxsave = info[2] & (1 << 27);
+        bool avx = info[2] & (1 << 28);
+        __cpuidex(info, 7, 0);
+        bool avx2 = info[1] & (1 << 5);
+        // NOTE(nic): the OS has to save the ymm registers too, not only the CPU support them
+        if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) {
+            utils_simd_level = SIMD_AVX2;
+        }
+    }
+#elif UTILS_SIMD
+    __builtin_cpu_init();
+    utils_simd_level = __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+#endif
+    utils_simd_supported = utils_simd_level;
+}
+
+static void simd_detect(void) {
+    call_once(&utils_simd_once, simd_detect_once);
+}
+
+Simd_Level simd_level(void) {
+    simd_detect();
+    return utils_simd_level;
+}
+
+void simd_set_level(Simd_Level level) {
+    simd_detect();
+    utils_simd_level = MIN(level, utils_simd_supported);
+}
+
+static bool is_space(char ch) {
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+static bool find_any_scalar(const char *data, size_t size, const char *set, size_t set_size, bool reverse, size_t *index) {
+    for (size_t k = 0; k < size; ++k) {
+        size_t i = reverse ? size - 1 - k : k;
+        for (size_t j = 0; j < set_size; ++j) {
+            if (data[i] == set[j]) {
                 *index = i;
+                return true;
             }
+        }
+    }
+    return false;
+}
+
+static bool find_nonspace_scalar(const char *data, size_t size, bool reverse, size_t *index) {
+    for (size_t k = 0; k < size; ++k) {
+        size_t i = reverse ? size - 1 - k : k;
+        if (!is_space(data[i])) {
+            *index = i;
             return true;
         }
     }
     return false;
 }
 
+#if UTILS_SIMD
+static size_t lowest_bit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward(&bit, mask);
+    return bit;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static size_t highest_bit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanReverse(&bit, mask);
+    return bit;
+#else
+    return 31 - __builtin_clz(mask);
+#endif
+}
+
+// NOTE(nic): Both vector widths walk whole blocks from the start (or from the end when
+// reversed) and leave the partial block to the scalar version, which in reverse is the
+// one at the front, so the blocks never read past the view
+static bool find_any_sse2(const char *data, size_t size, const char *set, size_t set_size, bool reverse, size_t *index) {
+    __m128i needles[SV_FIND_ANY_MAX];
+    for (size_t j = 0; j < set_size; ++j) {
+        needles[j] = _mm_set1_epi8(set[j]);
+    }
+    size_t blocks = size/16;
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t offset = reverse ? size - 16*(b + 1) : 16*b;
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (data + offset));
+        __m128i hits = _mm_setzero_si128();
+        for (size_t j = 0; j < set_size; ++j) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, needles[j]));
+        }
+        uint32_t mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            *index = offset + (reverse ? highest_bit(mask) : lowest_bit(mask));
+            return true;
+        }
+    }
+    size_t rest = size - 16*blocks;
+    size_t start = reverse ? 0 : 16*blocks;
+    if (find_any_scalar(data + start, rest, set, set_size, reverse, index)) {
+        *index += start;
+        return true;
+    }
+    return false;
+}
+
+static bool find_nonspace_sse2(const char *data, size_t size, bool reverse, size_t *index) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i controls = _mm_set1_epi8('\r' - '\t');
+    size_t blocks = size/16;
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t offset = reverse ? size - 16*(b + 1) : 16*b;
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (data + offset));
+        // '\t'..'\r' are the bytes that stay below 5 after subtracting '\t' (unsigned)
+        __m128i shifted = _mm_sub_epi8(bytes, tab);
+        __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, controls), shifted);
+        __m128i is_space = _mm_or_si128(is_control, _mm_cmpeq_epi8(bytes, space));
+        uint32_t mask = ~_mm_movemask_epi8(is_space) & 0xFFFF;
+        if (mask != 0) {
+            *index = offset + (reverse ? highest_bit(mask) : lowest_bit(mask));
+            return true;
+        }
+    }
+    size_t rest = size - 16*blocks;
+    size_t start = reverse ? 0 : 16*blocks;
+    if (find_nonspace_scalar(data + start, rest, reverse, index)) {
+        *index += start;
+        return true;
+    }
+    return false;
+}
+
+UTILS_TARGET_AVX2
+static bool find_any_avx2(const char *data, size_t size, const char *set, size_t set_size, bool reverse, size_t *index) {
+    __m256i needles[SV_FIND_ANY_MAX];
+    for (size_t j = 0; j < set_size; ++j) {
+        needles[j] = _mm256_set1_epi8(set[j]);
+    }
+    size_t blocks = size/32;
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t offset = reverse ? size - 32*(b + 1) : 32*b;
+        __m256i bytes = _mm256_loadu_si256((const __m256i *) (data + offset));
+        __m256i hits = _mm256_setzero_si256();
+        for (size_t j = 0; j < set_size; ++j) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(bytes, needles[j]));
+        }
+        uint32_t mask = _mm256_movemask_epi8(hits);
+        if (mask != 0) {
+            *index = offset + (reverse ? highest_bit(mask) : lowest_bit(mask));
+            return true;
+        }
+    }
+    size_t rest = size - 32*blocks;
+    size_t start = reverse ? 0 : 32*blocks;
+    if (find_any_sse2(data + start, rest, set, set_size, reverse, index)) {
+        *index += start;
+        return true;
+    }
+    return false;
+}
+
+UTILS_TARGET_AVX2
+static bool find_nonspace_avx2(const char *data, size_t size, bool reverse, size_t *index) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i controls = _mm256_set1_epi8('\r' - '\t');
+    size_t blocks = size/32;
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t offset = reverse ? size - 32*(b + 1) : 32*b;
+        __m256i bytes = _mm256_loadu_si256((const __m256i *) (data + offset));
+        __m256i shifted = _mm256_sub_epi8(bytes, tab);
+        __m256i is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, controls), shifted);
+        __m256i is_space = _mm256_or_si256(is_control, _mm256_cmpeq_epi8(bytes, space));
+        uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(is_space);
+        if (mask != 0) {
+            *index = offset + (reverse ? highest_bit(mask) : lowest_bit(mask));
+            return true;
+        }
+    }
+    size_t rest = size - 32*blocks;
+    size_t start = reverse ? 0 : 32*blocks;
+    if (find_nonspace_sse2(data + start, rest, reverse, index)) {
+        *index += start;
+        return true;
+    }
+    return false;
+}
+#endif // UTILS_SIMD
+
+static bool find_any(const char *data, size_t size, const char *set, size_t set_size, bool reverse, size_t *index) {
+#if UTILS_SIMD
+    if (set_size <= SV_FIND_ANY_MAX) {
+        switch (simd_level()) {
+        case SIMD_AVX2: return find_any_avx2(data, size, set, set_size, reverse, index);
+        case SIMD_SSE2: return find_any_sse2(data, size, set, set_size, reverse, index);
+        case SIMD_SCALAR: break;
+        }
+    }
+#endif
+    return find_any_scalar(data, size, set, set_size, reverse, index);
+}
+
+static bool find_nonspace(const char *data, size_t size, bool reverse, size_t *index) {
+#if UTILS_SIMD
+    switch (simd_level()) {
+    case SIMD_AVX2: return find_nonspace_avx2(data, size, reverse, index);
+    case SIMD_SSE2: return find_nonspace_sse2(data, size, reverse, index);
+    case SIMD_SCALAR: break;
+    }
+#endif
+    return find_nonspace_scalar(data, size, reverse, index);
+}
+
+bool sv_find(String_View sv, char ch, size_t *index) {
+    size_t i;
+    if (!find_any(sv.data, sv.size, &ch, 1, false, &i)) {
+        return false;
+    }
+    if (index != NULL) {
+        *index = i;
+    }
+    return true;
+}
+
 bool sv_find_rev(String_View sv, char ch, size_t *index) {
-    for (int i = sv.size; i >= 0; --i) {
-        if (sv.data[i] == ch) {
+    size_t i;
+    if (!find_any(sv.data, sv.size, &ch, 1, true, &i)) {
+        return false;
+    }
+    if (index != NULL) {
+        *index = i;
+    }
+    return true;
+}
+
+bool sv_find_any(String_View sv, const char *chars, size_t *index) {
+    size_t i;
+    if (!find_any(sv.data, sv.size, chars, strlen(chars), false, &i)) {
+        return false;
+    }
+    if (index != NULL) {
+        *index = i;
+    }
+    return true;
+}
+
+bool sv_find_sv_nocase(String_View sv, String_View needle, size_t *index) {
+    if (needle.size == 0) {
+        if (index != NULL) {
+            *index = 0;
+        }
+        return true;
+    }
+    if (needle.size > sv.size) {
+        return false;
+    }
+    // NOTE(nic): the vector scan jumps to the next byte that matches the first one of
+    // the needle in either case, only those places are compared in full
+    char first[2] = { needle.data[0], toupper((unsigned char) needle.data[0]) };
+    size_t first_size = first[0] == first[1] ? 1 : 2;
+    size_t last = sv.size - needle.size;
+    size_t i = 0;
+    size_t found;
+    while (i <= last && find_any(sv.data + i, last + 1 - i, first, first_size, false, &found)) {
+        i += found;
+        size_t j = 1;
+        while (j < needle.size && (char) tolower((unsigned char) sv.data[i + j]) == needle.data[j]) {
+            j += 1;
+        }
+        if (j == needle.size) {
             if (index != NULL) {
                 *index = i;
             }
             return true;
         }
+        i += 1;
     }
     return false;
 }
@@ -114,10 +408,8 @@ bool sv_starts_with(String_View sv, const char *prefix) {
 }
 
 String_View sv_chop_until(String_View *sv, char ch) {
-    size_t i = 0;
-    while (i < sv->size && sv->data[i] != ch) {
-        i += 1;
-    }
+    size_t i = sv->size;
+    sv_find(*sv, ch, &i);
 
     String_View result = sv_from_parts(sv->data, i);
     if (i < sv->size) {
@@ -131,19 +423,17 @@ String_View sv_chop_until(String_View *sv, char ch) {
 }
 
 String_View sv_trim_left(String_View sv) {
-    size_t i = 0;
-    while (i < sv.size && isspace(sv.data[i])) {
-        i += 1;
-    }
+    size_t i = sv.size;
+    find_nonspace(sv.data, sv.size, false, &i);
     return sv_from_parts(sv.data + i, sv.size - i);
 }
 
 String_View sv_trim_right(String_View sv) {
-    size_t i = 0;
-    while (i < sv.size && isspace(sv.data[sv.size - 1 - i])) {
-        i += 1;
+    size_t i;
+    if (!find_nonspace(sv.data, sv.size, true, &i)) {
+        return sv_from_parts(sv.data, 0);
     }
-    return sv_from_parts(sv.data, sv.size - i);
+    return sv_from_parts(sv.data, i + 1);
 }
 
 String_View sv_trim(String_View sv) {
@@ -11,6 +11,11 @@
 
 #include "./arena.h"
 
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define CLAMP(v, _min, _max) MIN(MAX(v, _min), _max)
+#define ARRAY_LEN(xs) (sizeof(xs)/sizeof((xs)[0]))
+
 #define arena_da_insert(a, da, i, item)                                 \
     do {                                                                \
         assert((i) <= (da)->count);                                     \
@@ -75,8 +80,26 @@ double sv_to_decimal(String_View sv);
 
 String_View sv_from_parts(const char *data, size_t size);
 
+// The widest set of characters `sv_find_any()` still scans with vectors
+#define SV_FIND_ANY_MAX 8
+
+typedef enum {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+} Simd_Level;
+
+// What the string scans use, picked from the CPU on first use. Setting it only lowers
+// it, which is meant for comparing against the scalar code.
+Simd_Level simd_level(void);
+void simd_set_level(Simd_Level level);
+
 bool sv_find(String_View sv, char ch, size_t *index);
 bool sv_find_rev(String_View sv, char ch, size_t *index);
+// First occurrence of any of the characters in `chars`, e.g. "\n\t\033"
+bool sv_find_any(String_View sv, const char *chars, size_t *index);
+// ASCII case-insensitive, `needle` has to be lowercase already
+bool sv_find_sv_nocase(String_View sv, String_View needle, size_t *index);
 bool sv_eq(String_View a, String_View b);
 
 bool sv_starts_with(String_View sv, const char *prefix);
@@ -0,0 +1,208 @@
+// Checks every vector level of the string scans in utils.c against plain loops, on
+// random text at every offset and every length around the vector widths.
+// `./build.sh test` builds and runs it, an optional argument sets the seed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../src/utils.h"
+#define ARENA_IMPLEMENTATION
+#include "../src/arena.h"
+
+#define BUFFER_SIZE 4096
+// Offsets from an aligned address, so the loads start anywhere in a vector
+#define MAX_OFFSET 64
+#define RANDOM_CASES 20000
+
+static const char *level_names[] = {
+    [SIMD_SCALAR] = "scalar",
+    [SIMD_SSE2]   = "sse2",
+    [SIMD_AVX2]   = "avx2",
+};
+
+// Every length up to here is tried at every offset, covering the tails of 15, 16,
+// 31, 32 and 33 bytes and both vector widths twice over
+#define EXHAUSTIVE_SIZE 100
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t) (rng_state >> 32);
+}
+
+// Mostly one filler byte, so the needles are rare and land anywhere including the tail
+static const char alphabet[] = "aAbB \t\n\v\f\r\033/\x80\xC3\xFFz";
+
+static void fill_random(char *data, size_t size) {
+    char filler = alphabet[rng() % (sizeof(alphabet) - 1)];
+    size_t density = 1 + rng() % 64;
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = rng() % density == 0 ? alphabet[rng() % (sizeof(alphabet) - 1)] : filler;
+    }
+}
+
+static bool ref_find_any(const char *data, size_t size, const char *set, bool reverse, size_t *index) {
+    for (size_t k = 0; k < size; ++k) {
+        size_t i = reverse ? size - 1 - k : k;
+        if (memchr(set, data[i], strlen(set)) != NULL) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ref_find_nocase(const char *data, size_t size, const char *needle, size_t needle_size, size_t *index) {
+    for (size_t i = 0; i + needle_size <= size; ++i) {
+        size_t j = 0;
+        while (j < needle_size && (char) tolower((unsigned char) data[i + j]) == needle[j]) {
+            j += 1;
+        }
+        if (j == needle_size) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ref_is_space(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+}
+
+static size_t failures = 0;
+
+static void check(bool ok, const char *kernel, Simd_Level level, size_t offset, size_t size) {
+    if (!ok) {
+        failures += 1;
+        if (failures <= 20) {
+            fprintf(stderr, "FAIL: %s at %s, offset %zu, size %zu\n", kernel, level_names[level], offset, size);
+        }
+    }
+}
+
+static void check_found(bool found, size_t index, bool ref_found, size_t ref_index,
+                        const char *kernel, Simd_Level level, size_t offset, size_t size) {
+    check(found == ref_found && (!found || index == ref_index), kernel, level, offset, size);
+}
+
+// The kernel runs before `index` is read, which arguments of one call do not guarantee
+#define CHECK_FOUND(call, ref, kernel)                                                      \
+    do {                                                                                    \
+        bool found = (call);                                                                \
+        check_found(found, index, (ref), ref_index, (kernel), level, offset, size);         \
+    } while (0)
+
+static void test_case(const char *data, size_t offset, size_t size, Simd_Level level) {
+    String_View sv = sv_from_parts(data, size);
+    size_t index = 0, ref_index = 0;
+
+    char ch = alphabet[rng() % (sizeof(alphabet) - 1)];
+    char single[2] = { ch, '\0' };
+    bool ref = ref_find_any(data, size, single, false, &ref_index);
+    CHECK_FOUND(sv_find(sv, ch, &index), ref, "sv_find");
+    ref = ref_find_any(data, size, single, true, &ref_index);
+    CHECK_FOUND(sv_find_rev(sv, ch, &index), ref, "sv_find_rev");
+
+    // One past SV_FIND_ANY_MAX too, which takes the scalar path at every level
+    char set[SV_FIND_ANY_MAX + 2] = {0};
+    size_t set_size = 1 + rng() % (SV_FIND_ANY_MAX + 1);
+    for (size_t i = 0; i < set_size; ++i) {
+        set[i] = alphabet[rng() % (sizeof(alphabet) - 1)];
+    }
+    ref = ref_find_any(data, size, set, false, &ref_index);
+    CHECK_FOUND(sv_find_any(sv, set, &index), ref, "sv_find_any");
+
+    // Needles are mostly lowered pieces of the text itself, so they are found
+    char needle[8];
+    size_t needle_size = 1 + rng() % sizeof(needle);
+    if (size >= needle_size && rng() % 4 != 0) {
+        size_t at = rng() % (size - needle_size + 1);
+        for (size_t i = 0; i < needle_size; ++i) {
+            needle[i] = tolower((unsigned char) data[at + i]);
+        }
+    } else {
+        for (size_t i = 0; i < needle_size; ++i) {
+            needle[i] = tolower((unsigned char) alphabet[rng() % (sizeof(alphabet) - 1)]);
+        }
+    }
+    ref = ref_find_nocase(data, size, needle, needle_size, &ref_index);
+    CHECK_FOUND(sv_find_sv_nocase(sv, sv_from_parts(needle, needle_size), &index), ref, "sv_find_sv_nocase");
+
+    size_t left = 0;
+    while (left < size && ref_is_space(data[left])) {
+        left += 1;
+    }
+    size_t right = size;
+    while (right > left && ref_is_space(data[right - 1])) {
+        right -= 1;
+    }
+    String_View trimmed = sv_trim_left(sv);
+    check(trimmed.data == data + left && trimmed.size == size - left, "sv_trim_left", level, offset, size);
+    trimmed = sv_trim_right(sv);
+    size_t right_only = size;
+    while (right_only > 0 && ref_is_space(data[right_only - 1])) {
+        right_only -= 1;
+    }
+    check(trimmed.data == data && trimmed.size == right_only, "sv_trim_right", level, offset, size);
+    trimmed = sv_trim(sv);
+    check(trimmed.data == data + left && trimmed.size == right - left, "sv_trim", level, offset, size);
+}
+
+static void test_trim_edges(char *data, size_t offset, size_t size, Simd_Level level) {
+    // All spaces, then a single non-space at every position
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = " \t\n\v\f\r"[i % 6];
+    }
+    check(sv_trim(sv_from_parts(data, size)).size == 0, "sv_trim", level, offset, size);
+    for (size_t at = 0; at < size; ++at) {
+        char saved = data[at];
+        data[at] = 'x';
+        String_View trimmed = sv_trim(sv_from_parts(data, size));
+        check(trimmed.data == data + at && trimmed.size == 1, "sv_trim", level, offset, size);
+        data[at] = saved;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        rng_state = strtoull(argv[1], NULL, 0) | 1;
+    }
+    static char buffer[BUFFER_SIZE + MAX_OFFSET];
+    for (Simd_Level level = SIMD_SCALAR; level <= SIMD_AVX2; ++level) {
+        simd_set_level(level);
+        if (simd_level() != level) {
+            printf("simd: %s is not supported here, skipped\n", level_names[level]);
+            continue;
+        }
+        size_t cases = 0;
+        size_t failures_before = failures;
+        for (size_t offset = 0; offset < MAX_OFFSET; ++offset) {
+            for (size_t size = 0; size <= EXHAUSTIVE_SIZE; ++size) {
+                fill_random(buffer + offset, size);
+                test_case(buffer + offset, offset, size, level);
+                test_trim_edges(buffer + offset, offset, size, level);
+                cases += 1;
+            }
+        }
+        for (size_t i = 0; i < RANDOM_CASES; ++i) {
+            size_t offset = rng() % MAX_OFFSET;
+            size_t size = rng() % (BUFFER_SIZE + 1);
+            fill_random(buffer + offset, size);
+            test_case(buffer + offset, offset, size, level);
+            cases += 1;
+        }
+        printf("simd: %s: %zu cases, %zu failures\n", level_names[level], cases, failures - failures_before);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "simd: %zu failures\n", failures);
+        return 1;
+    }
+    return 0;
+}